@@ -0,0 +1,99 @@
+#include "HyprsunsetProcess.hpp"
+#include "MockCompositor.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+CHyprsunsetProcess::~CHyprsunsetProcess() {
+    stop();
+}
+
+bool CHyprsunsetProcess::prepare(const std::string& config) {
+    char dirTemplate[] = "/tmp/hyprsunset-bench-XXXXXX";
+    if (!mkdtemp(dirTemplate))
+        return false;
+
+    m_sRuntimeDir = dirTemplate;
+
+    // the daemon puts its socket here when it isn't running under hyprland
+    setenv("XDG_RUNTIME_DIR", m_sRuntimeDir.c_str(), 1);
+    unsetenv("HYPRLAND_INSTANCE_SIGNATURE");
+    m_sIPCPath = m_sRuntimeDir + "/hypr/.hyprsunset.sock";
+
+    std::ofstream(m_sRuntimeDir + "/hyprsunset.conf") << config;
+
+    return true;
+}
+
+bool CHyprsunsetProcess::launch(const std::string& binary, CMockCompositor& compositor) {
+    const auto CONFIGPATH = m_sRuntimeDir + "/hyprsunset.conf";
+    const auto STARTED    = std::chrono::steady_clock::now();
+
+    m_pid = fork();
+
+    if (m_pid == 0) {
+        setenv("WAYLAND_DISPLAY", compositor.socketName().c_str(), 1);
+
+        // the daemon logs every request, that's not what we're looking at
+        freopen("/dev/null", "w", stdout);
+        execl(binary.c_str(), binary.c_str(), "-c", CONFIGPATH.c_str(), nullptr);
+        _exit(127);
+    }
+
+    if (m_pid < 0)
+        return false;
+
+    // the first commit means it's up, the socket comes right after
+    if (!compositor.waitForCommit(STARTED, std::chrono::seconds(5)))
+        return false;
+
+    for (int i = 0; i < 500; ++i) {
+        if (const int FD = connectIPC(); FD >= 0) {
+            close(FD);
+            return true;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    return false;
+}
+
+void CHyprsunsetProcess::stop() {
+    if (m_pid > 0) {
+        kill(m_pid, SIGTERM);
+        waitpid(m_pid, nullptr, 0);
+        m_pid = -1;
+    }
+
+    if (!m_sRuntimeDir.empty()) {
+        std::filesystem::remove_all(m_sRuntimeDir);
+        m_sRuntimeDir.clear();
+    }
+}
+
+int CHyprsunsetProcess::connectIPC() const {
+    const int FD = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (FD < 0)
+        return -1;
+
+    sockaddr_un address = {.sun_family = AF_UNIX};
+    strncpy(address.sun_path, m_sIPCPath.c_str(), sizeof(address.sun_path) - 1);
+
+    if (connect(FD, (sockaddr*)&address, SUN_LEN(&address)) < 0) {
+        close(FD);
+        return -1;
+    }
+
+    return FD;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <sys/types.h>
+
+class CMockCompositor;
+
+// A real hyprsunset running against a CMockCompositor, in a runtime dir of its own that's removed again on stop().
+// Shared by the load benchmark and the tests.
+
+class CHyprsunsetProcess {
+  public:
+    ~CHyprsunsetProcess();
+
+    // creates the runtime dir holding config and points XDG_RUNTIME_DIR at it. do this before starting the compositor, its socket goes there too
+    bool        prepare(const std::string& config);
+
+    // starts binary and waits until it committed and its socket takes connections, false if it didn't come up
+    bool        launch(const std::string& binary, CMockCompositor& compositor);
+    void        stop();
+
+    // a blocking connection to its IPC socket, -1 on failure. safe to call from any thread
+    int         connectIPC() const;
+
+  private:
+    pid_t       m_pid = -1;
+    std::string m_sRuntimeDir;
+    std::string m_sIPCPath;
+};
@@ -0,0 +1,238 @@
+#include "HyprsunsetProcess.hpp"
+#include "MockCompositor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+// Runs a real hyprsunset against the mock compositor and hammers its IPC socket.
+// Usage: hyprsunset-bench-load [path to hyprsunset]
+
+using Time = std::chrono::steady_clock::time_point;
+
+struct SScenarioResult {
+    std::string              name;
+    size_t                   requests = 0;
+    size_t                   failed   = 0;
+    double                   seconds  = 0;
+    std::vector<Time>        sent;
+    std::vector<SMockCommit> commits;
+};
+
+static CHyprsunsetProcess    hyprsunset;
+static std::atomic<uint64_t> requestCounter = 0;
+
+static bool sendAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const auto LEN = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (LEN < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data.remove_prefix(LEN);
+    }
+
+    return true;
+}
+
+// reads until lines replies arrived
+static bool readReplies(int fd, size_t lines) {
+    char buffer[4096];
+
+    while (lines > 0) {
+        const auto LEN = read(fd, buffer, sizeof(buffer));
+        if (LEN < 0 && errno == EINTR)
+            continue;
+        if (LEN <= 0)
+            return false;
+
+        lines -= std::min<size_t>(lines, std::count(buffer, buffer + LEN, '\n'));
+    }
+
+    return true;
+}
+
+// alternates between two far apart temperatures, consecutive requests always change the matrix
+static std::string nextRequest() {
+    return std::format("temperature {}\n", requestCounter++ % 2 ? 3000 : 6500);
+}
+
+// each client sends count requests one at a time, waiting for every reply
+static void runClient(size_t count, std::vector<Time>& sent, size_t& failed) {
+    const int FD = hyprsunset.connectIPC();
+    if (FD < 0) {
+        failed += count;
+        return;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        sent.emplace_back(std::chrono::steady_clock::now());
+        if (!sendAll(FD, nextRequest()) || !readReplies(FD, 1)) {
+            failed += count - i;
+            break;
+        }
+    }
+
+    close(FD);
+}
+
+static SScenarioResult runClients(CMockCompositor& compositor, std::string name, size_t clients, size_t perClient, std::function<void(std::atomic<bool>&)> background = {}) {
+    SScenarioResult                result{.name = std::move(name)};
+    std::vector<std::vector<Time>> sent(clients);
+    std::vector<size_t>            failed(clients);
+    std::vector<std::thread>       threads;
+    std::atomic<bool>              done = false;
+
+    compositor.clear();
+
+    const auto  BEGIN = std::chrono::steady_clock::now();
+
+    std::thread backgroundThread;
+    if (background)
+        backgroundThread = std::thread([&background, &done]() { background(done); });
+
+    for (size_t i = 0; i < clients; ++i) {
+        threads.emplace_back([&, i]() { runClient(perClient, sent[i], failed[i]); });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    done = true;
+    if (backgroundThread.joinable())
+        backgroundThread.join();
+
+    // the last request's commit is still on its way
+    compositor.waitForCommit(std::chrono::steady_clock::now() - std::chrono::milliseconds(1), std::chrono::milliseconds(100));
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - BEGIN).count();
+    result.commits = compositor.commits();
+
+    for (size_t i = 0; i < clients; ++i) {
+        result.sent.insert(result.sent.end(), sent[i].begin(), sent[i].end());
+        result.failed += failed[i];
+    }
+    result.requests = clients * perClient - result.failed;
+
+    return result;
+}
+
+// one client writes everything at once, the daemon has to split it up. keep it under IPC_MAX_REQUEST_SIZE, it only reads that much per wakeup
+static SScenarioResult runBurst(CMockCompositor& compositor, size_t count) {
+    SScenarioResult result{.name = std::format("burst x{}", count)};
+
+    compositor.clear();
+
+    std::string batch;
+    for (size_t i = 0; i < count; ++i) {
+        batch += nextRequest();
+    }
+
+    const int FD = hyprsunset.connectIPC();
+
+    const auto BEGIN = std::chrono::steady_clock::now();
+    result.sent.assign(count, BEGIN);
+
+    if (FD < 0 || !sendAll(FD, batch) || !readReplies(FD, count))
+        result.failed = count;
+
+    compositor.waitForCommit(std::chrono::steady_clock::now() - std::chrono::milliseconds(1), std::chrono::milliseconds(100));
+
+    result.seconds  = std::chrono::duration<double>(std::chrono::steady_clock::now() - BEGIN).count();
+    result.commits  = compositor.commits();
+    result.requests = count - result.failed;
+
+    if (FD >= 0)
+        close(FD);
+
+    return result;
+}
+
+static double percentile(std::vector<double>& values, double q) {
+    if (values.empty())
+        return 0;
+
+    const auto NTH = values.begin() + (size_t)(q * (values.size() - 1));
+    std::nth_element(values.begin(), NTH, values.end());
+    return *NTH;
+}
+
+static void report(SScenarioResult& result) {
+    std::vector<Time> commitTimes;
+    for (const auto& c : result.commits) {
+        commitTimes.emplace_back(c.at);
+    }
+    std::sort(commitTimes.begin(), commitTimes.end());
+
+    // a request's latency is the time until the first commit after it was sent
+    std::vector<double> latencies;
+    for (const auto& s : result.sent) {
+        const auto COMMIT = std::lower_bound(commitTimes.begin(), commitTimes.end(), s);
+        if (COMMIT != commitTimes.end())
+            latencies.emplace_back(std::chrono::duration<double, std::micro>(*COMMIT - s).count());
+    }
+
+    std::cout << std::format("{:<24} {:>9} {:>7} {:>12.0f} {:>10.0f} {:>10.0f} {:>8}\n", result.name, result.requests, result.failed, result.requests / result.seconds,
+                             percentile(latencies, 0.5), percentile(latencies, 0.99), result.commits.size());
+}
+
+int main(int argc, char** argv) {
+    const std::string BINARY = argc > 1 ? argv[1] : HYPRSUNSET_BINARY;
+
+    if (!hyprsunset.prepare("ipc {\n    timeout = 0\n    backlog = 128\n}\n")) {
+        std::cerr << "Couldn't create a runtime dir: " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    CMockCompositor compositor;
+    if (!compositor.start()) {
+        std::cerr << "Couldn't start the mock compositor\n";
+        return 1;
+    }
+
+    compositor.addOutput("BENCH-1", "hyprsunset mock output 1");
+    compositor.addOutput("BENCH-2", "hyprsunset mock output 2");
+
+    if (!hyprsunset.launch(BINARY, compositor)) {
+        std::cerr << "hyprsunset (" << BINARY << ") didn't come up\n";
+        return 1;
+    }
+
+    std::cout << std::format("{:<24} {:>9} {:>7} {:>12} {:>10} {:>10} {:>8}\n", "scenario", "requests", "failed", "requests/s", "p50 us", "p99 us", "commits");
+
+    std::vector<SScenarioResult> results;
+    results.emplace_back(runClients(compositor, "sequential", 1, 2000));
+    results.emplace_back(runClients(compositor, "clients x32", 32, 200));
+    results.emplace_back(runBurst(compositor, 200));
+    results.emplace_back(runClients(compositor, "hotplug storm x8", 8, 200, [&compositor](std::atomic<bool>& done) {
+        for (size_t i = 0; !done; ++i) {
+            const auto NAME = std::format("STORM-{}", i % 4);
+            if (i % 8 < 4)
+                compositor.addOutput(NAME, "hyprsunset mock hotplug output");
+            else
+                compositor.removeOutput(NAME);
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    }));
+
+    for (auto& r : results) {
+        report(r);
+    }
+
+    hyprsunset.stop();
+    compositor.stop();
+
+    return 0;
+}
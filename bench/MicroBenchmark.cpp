@@ -0,0 +1,129 @@
+#include "src/Hyprsunset.hpp"
+#include "src/IPCSocket.hpp"
+#include "src/helpers/GammaRamp.hpp"
+#include "src/helpers/Log.hpp"
+#include "src/helpers/Matrix.hpp"
+
+#include <array>
+#include <chrono>
+#include <fcntl.h>
+#include <format>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Times the hot paths in isolation. Prints one json object per line:
+// {"benchmark":NAME,"param":N,"iterations":N,"ns_per_op":N}
+// Usage: hyprsunset-bench-micro [min milliseconds per benchmark, default 200]
+
+static std::chrono::milliseconds minDuration{200};
+
+template <typename T>
+static void doNotOptimize(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// doubles the iteration count until a run takes long enough to trust
+template <typename Fn>
+static void bench(std::string_view name, size_t param, Fn&& fn) {
+    size_t iterations = 1;
+    double seconds    = 0;
+
+    while (true) {
+        const auto BEGIN = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            fn(i);
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - BEGIN).count();
+
+        if (seconds >= std::chrono::duration<double>(minDuration).count() || iterations >= (1ULL << 32))
+            break;
+
+        iterations *= 2;
+    }
+
+    std::cout << std::format(R"({{"benchmark":"{}","param":{},"iterations":{},"ns_per_op":{:.2f}}})", name, param, iterations, seconds * 1e9 / iterations) << std::endl;
+}
+
+// spread evenly over the day
+static std::vector<SSunsetProfile> makeProfiles(size_t count) {
+    std::vector<SSunsetProfile> result;
+    result.reserve(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        const auto MINUTE = i * 24 * 60 / count;
+        result.emplace_back(SSunsetProfile{
+            .time        = {.hour = std::chrono::hours(MINUTE / 60), .minute = std::chrono::minutes(MINUTE % 60)},
+            .temperature = 3000 + (i % 30) * 100,
+        });
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1)
+        minDuration = std::chrono::milliseconds(std::stoul(argv[1]));
+
+    // the results go to stdout, the daemon's logging doesn't
+    Debug::outputFD = open("/dev/null", O_WRONLY | O_CLOEXEC);
+
+    CHyprsunset hyprsunset;
+
+    for (const auto MODEL : {KELVIN_MODEL_APPROXIMATE, KELVIN_MODEL_PLANCKIAN}) {
+        bench(MODEL == KELVIN_MODEL_PLANCKIAN ? "matrixForKelvin/planckian" : "matrixForKelvin/approximate", 0,
+              [MODEL](size_t i) { doNotOptimize(matrixForKelvin(1000 + (i * 7) % 19000, MODEL)); });
+    }
+
+    // calculateMatrix always logs, queueing the lines is part of its cost
+    bench("calculateMatrix", 0, [&hyprsunset](size_t i) {
+        hyprsunset.KELVIN = 1000 + (i * 7) % 19000;
+        doNotOptimize(hyprsunset.calculateMatrix());
+    });
+
+    // a whole table per transition frame and output on the gamma-control path
+    for (const uint32_t SIZE : {256, 1024, 4096}) {
+        std::vector<uint16_t> table(SIZE * 3);
+
+        bench("GammaRamp::fill/linear", SIZE, [&table, SIZE](size_t i) {
+            GammaRamp::fill(table.data(), SIZE, {1.f, 0.8f, 0.6f - (i % 100) * 0.001f}, 1.f);
+            doNotOptimize(table);
+        });
+        bench("GammaRamp::fill/exponent", SIZE, [&table, SIZE](size_t i) {
+            GammaRamp::fill(table.data(), SIZE, {1.f, 0.8f, 0.6f}, 2.2f - (i % 100) * 0.001f);
+            doNotOptimize(table);
+        });
+    }
+
+    for (const size_t COUNT : {2, 10, 100, 1000, 10000}) {
+        hyprsunset.setProfiles(makeProfiles(COUNT));
+        bench("currentProfile", COUNT, [&hyprsunset](size_t) { doNotOptimize(hyprsunset.currentProfile()); });
+    }
+
+    // what scripts and keybinds actually send, queries outnumber changes
+    static constexpr std::array<std::string_view, 13> MIX = {
+        "temperature", "gamma", "temperature 4500", "gamma 80", "temperature +250", "gamma -5", "identity get", "identity false", "set temperature=5000 gamma=90",
+        "profile",     "-j",    "stats",            "bogus",
+    };
+
+    hyprsunset.setProfiles(makeProfiles(4));
+
+    CIPCSocket  ipc(&hyprsunset);
+    std::string reply;
+    reply.reserve(4096);
+
+    for (const auto& REQUEST : MIX) {
+        bench(std::format("mainThreadParseRequest/{}", REQUEST), 0, [&ipc, &reply, REQUEST](size_t) {
+            reply.clear();
+            doNotOptimize(ipc.mainThreadParseRequest(REQUEST, reply));
+        });
+    }
+
+    bench("mainThreadParseRequest/mix", MIX.size(), [&ipc, &reply](size_t i) {
+        reply.clear();
+        doNotOptimize(ipc.mainThreadParseRequest(MIX[i % MIX.size()], reply));
+    });
+
+    return 0;
+}
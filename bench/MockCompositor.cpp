@@ -0,0 +1,213 @@
+#include "MockCompositor.hpp"
+#include "mock-protocols/wayland.hpp"
+#include "mock-protocols/hyprland-ctm-control-v1.hpp"
+
+#include <algorithm>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+CMockCompositor::~CMockCompositor() {
+    stop();
+}
+
+bool CMockCompositor::start() {
+    m_pDisplay = wl_display_create();
+    if (!m_pDisplay)
+        return false;
+
+    const auto SOCKET = wl_display_add_socket_auto(m_pDisplay);
+    if (!SOCKET) {
+        wl_display_destroy(m_pDisplay);
+        m_pDisplay = nullptr;
+        return false;
+    }
+
+    m_sSocket    = SOCKET;
+    m_pCTMGlobal = wl_global_create(m_pDisplay, &hyprland_ctm_control_manager_v1_interface, 2, this, bindCTMManager);
+
+    // other threads hand work to the display thread through this
+    m_iQueueFD = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    wl_event_loop_add_fd(wl_display_get_event_loop(m_pDisplay), m_iQueueFD, WL_EVENT_READABLE, onQueue, this);
+
+    m_thread = std::thread([this]() { run(); });
+
+    return true;
+}
+
+void CMockCompositor::stop() {
+    if (!m_thread.joinable())
+        return;
+
+    post([this]() { wl_display_terminate(m_pDisplay); });
+    m_thread.join();
+
+    // the loop is gone, everything below is safe to do from here
+    m_vManagers.clear();
+    for (auto& o : m_vOutputs) {
+        o->resources.clear();
+        wl_global_destroy(o->global);
+    }
+    m_vOutputs.clear();
+
+    wl_global_destroy(m_pCTMGlobal);
+    wl_display_destroy_clients(m_pDisplay);
+    wl_display_destroy(m_pDisplay);
+    close(m_iQueueFD);
+
+    m_pDisplay   = nullptr;
+    m_pCTMGlobal = nullptr;
+    m_iQueueFD   = -1;
+}
+
+std::string CMockCompositor::socketName() const {
+    return m_sSocket;
+}
+
+void CMockCompositor::run() {
+    wl_display_run(m_pDisplay);
+}
+
+void CMockCompositor::post(std::function<void()> fn) {
+    {
+        std::lock_guard lg(m_queueMutex);
+        m_vQueue.emplace_back(std::move(fn));
+    }
+
+    const uint64_t ONE = 1;
+    write(m_iQueueFD, &ONE, sizeof(ONE));
+}
+
+int CMockCompositor::onQueue(int fd, uint32_t mask, void* data) {
+    const auto SELF = (CMockCompositor*)data;
+
+    uint64_t   count = 0;
+    read(fd, &count, sizeof(count));
+
+    std::vector<std::function<void()>> queue;
+    {
+        std::lock_guard lg(SELF->m_queueMutex);
+        queue.swap(SELF->m_vQueue);
+    }
+
+    for (auto& fn : queue) {
+        fn();
+    }
+
+    return 0;
+}
+
+void CMockCompositor::addOutput(const std::string& name, const std::string& description) {
+    post([this, name, description]() {
+        auto& output   = m_vOutputs.emplace_back(std::make_unique<SOutputGlobal>(SOutputGlobal{.name = name, .description = description}));
+        output->global = wl_global_create(m_pDisplay, &wl_output_interface, 4, output.get(), bindOutput);
+    });
+}
+
+void CMockCompositor::removeOutput(const std::string& name) {
+    post([this, name]() {
+        const auto OUTPUT = std::find_if(m_vOutputs.begin(), m_vOutputs.end(), [&name](const auto& o) { return !o->removed && o->name == name; });
+        if (OUTPUT == m_vOutputs.end())
+            return;
+
+        wl_global_remove((*OUTPUT)->global);
+        (*OUTPUT)->removed = true;
+    });
+}
+
+void CMockCompositor::bindOutput(wl_client* client, void* data, uint32_t version, uint32_t id) {
+    const auto OUTPUT   = (SOutputGlobal*)data;
+    const auto RESOURCE = OUTPUT->resources.emplace_back(makeShared<CWlOutput>(client, version, id));
+
+    if (!RESOURCE->resource()) {
+        wl_client_post_no_memory(client);
+        OUTPUT->resources.pop_back();
+        return;
+    }
+
+    const auto DESTROY = [OUTPUT](CWlOutput* r) { std::erase_if(OUTPUT->resources, [r](const auto& e) { return e.get() == r; }); };
+    RESOURCE->setRelease(DESTROY);
+    RESOURCE->setOnDestroy(DESTROY);
+
+    RESOURCE->sendGeometry(0, 0, 600, 340, WL_OUTPUT_SUBPIXEL_UNKNOWN, "hyprsunset", "mock", WL_OUTPUT_TRANSFORM_NORMAL);
+    RESOURCE->sendMode((wl_output_mode)(WL_OUTPUT_MODE_CURRENT | WL_OUTPUT_MODE_PREFERRED), 1920, 1080, 60000);
+
+    if (version >= 2)
+        RESOURCE->sendScale(1);
+
+    if (version >= 4) {
+        RESOURCE->sendName(OUTPUT->name.c_str());
+        RESOURCE->sendDescription(OUTPUT->description.c_str());
+    }
+
+    if (version >= 2)
+        RESOURCE->sendDone();
+}
+
+void CMockCompositor::bindCTMManager(wl_client* client, void* data, uint32_t version, uint32_t id) {
+    const auto SELF     = (CMockCompositor*)data;
+    const auto RESOURCE = SELF->m_vManagers.emplace_back(makeShared<CHyprlandCtmControlManagerV1>(client, version, id));
+
+    if (!RESOURCE->resource()) {
+        wl_client_post_no_memory(client);
+        SELF->m_vManagers.pop_back();
+        return;
+    }
+
+    const auto DESTROY = [SELF](CHyprlandCtmControlManagerV1* r) { std::erase_if(SELF->m_vManagers, [r](const auto& e) { return e.get() == r; }); };
+    RESOURCE->setDestroy(DESTROY);
+    RESOURCE->setOnDestroy(DESTROY);
+
+    RESOURCE->setSetCtmForOutput([SELF](CHyprlandCtmControlManagerV1* r, wl_resource* output, wl_fixed_t mat0, wl_fixed_t mat1, wl_fixed_t mat2, wl_fixed_t mat3, wl_fixed_t mat4,
+                                        wl_fixed_t mat5, wl_fixed_t mat6, wl_fixed_t mat7, wl_fixed_t mat8) {
+        const auto  NOW = std::chrono::steady_clock::now();
+
+        std::string name;
+        for (const auto& o : SELF->m_vOutputs) {
+            if (std::ranges::any_of(o->resources, [output](const auto& e) { return e->resource() == output; }))
+                name = o->name;
+        }
+
+        std::lock_guard lg(SELF->m_recordMutex);
+        SELF->m_vCTMs.emplace_back(SMockCTM{.at = NOW, .output = std::move(name), .ctm = {mat0, mat1, mat2, mat3, mat4, mat5, mat6, mat7, mat8}});
+        SELF->m_iUncommitted++;
+    });
+
+    RESOURCE->setCommit([SELF](CHyprlandCtmControlManagerV1* r) {
+        const auto NOW = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard lg(SELF->m_recordMutex);
+            SELF->m_vCommits.emplace_back(SMockCommit{.at = NOW, .ctms = SELF->m_iUncommitted});
+            SELF->m_iUncommitted = 0;
+        }
+
+        SELF->m_commitSignal.notify_all();
+    });
+}
+
+std::vector<SMockCTM> CMockCompositor::ctms() {
+    std::lock_guard lg(m_recordMutex);
+    return m_vCTMs;
+}
+
+std::vector<SMockCommit> CMockCompositor::commits() {
+    std::lock_guard lg(m_recordMutex);
+    return m_vCommits;
+}
+
+size_t CMockCompositor::commitCount() {
+    std::lock_guard lg(m_recordMutex);
+    return m_vCommits.size();
+}
+
+void CMockCompositor::clear() {
+    std::lock_guard lg(m_recordMutex);
+    m_vCTMs.clear();
+    m_vCommits.clear();
+}
+
+bool CMockCompositor::waitForCommit(std::chrono::steady_clock::time_point since, std::chrono::milliseconds timeout) {
+    std::unique_lock lock(m_recordMutex);
+
+    return m_commitSignal.wait_for(lock, timeout, [this, since]() { return !m_vCommits.empty() && m_vCommits.back().at > since; });
+}
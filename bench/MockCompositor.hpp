@@ -0,0 +1,93 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wayland-server-core.h>
+
+#include <hyprutils/memory/SharedPtr.hpp>
+using namespace Hyprutils::Memory;
+#define SP CSharedPointer
+
+class CWlOutput;
+class CHyprlandCtmControlManagerV1;
+
+// A headless compositor speaking just wl_output and hyprland-ctm-control-v1, enough for hyprsunset to run against.
+// Everything the client sends is recorded with a timestamp. The display runs on its own thread, the public methods are safe to call from any other.
+
+struct SMockCTM {
+    std::chrono::steady_clock::time_point at;
+    std::string                           output;
+    std::array<wl_fixed_t, 9>             ctm = {};
+};
+
+struct SMockCommit {
+    std::chrono::steady_clock::time_point at;
+    size_t                                ctms = 0; // set_ctm_for_output requests since the previous commit
+};
+
+class CMockCompositor {
+  public:
+    ~CMockCompositor();
+
+    // creates the display on a socket in $XDG_RUNTIME_DIR and starts dispatching, returns false if that failed
+    bool                     start();
+    void                     stop();
+
+    // what to put into WAYLAND_DISPLAY
+    std::string              socketName() const;
+
+    // announce / withdraw a wl_output global, outputs are identified by name
+    void                     addOutput(const std::string& name, const std::string& description);
+    void                     removeOutput(const std::string& name);
+
+    std::vector<SMockCTM>    ctms();
+    std::vector<SMockCommit> commits();
+    size_t                   commitCount();
+    void                     clear();
+
+    // blocks until a commit arrived after since, false if the timeout passed first
+    bool                     waitForCommit(std::chrono::steady_clock::time_point since, std::chrono::milliseconds timeout);
+
+  private:
+    struct SOutputGlobal {
+        std::string                name, description;
+        wl_global*                 global  = nullptr;
+        bool                       removed = false; // the global stays around until stop(), clients may still be binding it
+        std::vector<SP<CWlOutput>> resources;
+    };
+
+    void                                          run();
+    void                                          post(std::function<void()> fn);
+
+    static void                                   bindOutput(wl_client* client, void* data, uint32_t version, uint32_t id);
+    static void                                   bindCTMManager(wl_client* client, void* data, uint32_t version, uint32_t id);
+    static int                                    onQueue(int fd, uint32_t mask, void* data);
+
+    wl_display*                                   m_pDisplay   = nullptr;
+    wl_global*                                    m_pCTMGlobal = nullptr;
+    int                                           m_iQueueFD   = -1;
+    std::string                                   m_sSocket;
+    std::thread                                   m_thread;
+
+    std::mutex                                    m_queueMutex;
+    std::vector<std::function<void()>>            m_vQueue;
+
+    // only touched on the display thread
+    std::vector<std::unique_ptr<SOutputGlobal>>   m_vOutputs;
+    std::vector<SP<CHyprlandCtmControlManagerV1>> m_vManagers;
+    size_t                                        m_iUncommitted = 0;
+
+    std::mutex                                    m_recordMutex;
+    std::condition_variable                       m_commitSignal;
+    std::vector<SMockCTM>                         m_vCTMs;
+    std::vector<SMockCommit>                      m_vCommits;
+};
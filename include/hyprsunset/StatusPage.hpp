@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// What hyprsunset is showing, for status bars and widgets that would otherwise ask the socket every few seconds. The daemon keeps a small file
+// next to its socket mapped and rewrites it under a seqlock on every change: map it once with CStatusPageReader, after that read() is a handful of
+// loads and no syscalls, however often and from however many processes it's polled. Header only, nothing to link.
+namespace Hyprsunset {
+    inline constexpr uint32_t STATUS_PAGE_MAGIC   = 0x70737368; // "hssp"
+    inline constexpr uint32_t STATUS_PAGE_VERSION = 1;
+    inline constexpr size_t   STATUS_PROFILE_SIZE = 32;
+
+    // the file's layout. everything below sequence is written between two increments of it, it's odd while the daemon is in the middle
+    struct SStatusPage {
+        uint32_t              magic   = STATUS_PAGE_MAGIC;
+        uint32_t              version = STATUS_PAGE_VERSION;
+
+        std::atomic<uint64_t> sequence = 0;
+        std::atomic<uint32_t> closed   = 0; // the daemon exited and removed the file, a new one comes with the next start
+
+        std::atomic<uint32_t> temperature    = 0;
+        std::atomic<float>    gamma          = 1.f; // 1 is 100%
+        std::atomic<uint32_t> identity       = 0;
+        std::atomic<int32_t>  profile        = -1; // index of the active profile, -1 without one
+        std::atomic<int64_t>  nextTransition = 0;  // unix seconds, 0 if no switch is coming
+
+        // the active profile's time as written in the config, null terminated
+        std::atomic<char> profileTime[STATUS_PROFILE_SIZE];
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<float>::is_always_lock_free, "the page is shared between processes");
+
+    // one consistent read of the page
+    struct SStatus {
+        uint64_t sequence       = 0; // changes with every update
+        uint32_t temperature    = 0;
+        float    gamma          = 1.f;
+        bool     identity       = false;
+        int32_t  profile        = -1;
+        int64_t  nextTransition = 0;
+        char     profileTime[STATUS_PROFILE_SIZE];
+    };
+
+    // next to the socket: $XDG_RUNTIME_DIR/hypr/[$HYPRLAND_INSTANCE_SIGNATURE/].hyprsunset.status
+    inline std::string statusPagePath() {
+        const auto        HIS     = getenv("HYPRLAND_INSTANCE_SIGNATURE");
+        const auto        RUNTIME = getenv("XDG_RUNTIME_DIR");
+        const std::string USERDIR = RUNTIME ? RUNTIME + std::string{"/hypr/"} : "/run/user/" + std::to_string(getuid()) + "/hypr/";
+
+        return HIS ? USERDIR + HIS + "/.hyprsunset.status" : USERDIR + ".hyprsunset.status";
+    }
+
+    class CStatusPageReader {
+      public:
+        explicit CStatusPageReader(const std::string& path = statusPagePath()) {
+            const int FD = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (FD < 0)
+                return;
+
+            // a shorter file would SIGBUS on the first read past its end
+            struct stat st;
+            if (fstat(FD, &st) < 0 || (size_t)st.st_size < sizeof(SStatusPage)) {
+                close(FD);
+                return;
+            }
+
+            const auto MAP = mmap(nullptr, sizeof(SStatusPage), PROT_READ, MAP_SHARED, FD, 0);
+            close(FD);
+
+            if (MAP == MAP_FAILED)
+                return;
+
+            m_pPage = (const SStatusPage*)MAP;
+
+            if (m_pPage->magic != STATUS_PAGE_MAGIC || m_pPage->version != STATUS_PAGE_VERSION) {
+                munmap((void*)m_pPage, sizeof(SStatusPage));
+                m_pPage = nullptr;
+            }
+        }
+
+        ~CStatusPageReader() {
+            if (m_pPage)
+                munmap((void*)m_pPage, sizeof(SStatusPage));
+        }
+
+        CStatusPageReader(const CStatusPageReader&)            = delete;
+        CStatusPageReader& operator=(const CStatusPageReader&) = delete;
+
+        // false if hyprsunset isn't running (or is too old to publish a page)
+        bool valid() const {
+            return m_pPage;
+        }
+
+        // nullopt once the daemon exited, make a new reader to pick up the next one. also if every attempt raced a write, which takes a
+        // few dozen nanoseconds, so that's practically never
+        std::optional<SStatus> read(int attempts = 64) const {
+            if (!m_pPage)
+                return std::nullopt;
+
+            for (int i = 0; i < attempts; ++i) {
+                if (m_pPage->closed.load(std::memory_order_relaxed))
+                    return std::nullopt;
+
+                const auto BEFORE = m_pPage->sequence.load(std::memory_order_acquire);
+                if (BEFORE & 1)
+                    continue;
+
+                SStatus status;
+                status.sequence       = BEFORE;
+                status.temperature    = m_pPage->temperature.load(std::memory_order_relaxed);
+                status.gamma          = m_pPage->gamma.load(std::memory_order_relaxed);
+                status.identity       = m_pPage->identity.load(std::memory_order_relaxed);
+                status.profile        = m_pPage->profile.load(std::memory_order_relaxed);
+                status.nextTransition = m_pPage->nextTransition.load(std::memory_order_relaxed);
+                for (size_t c = 0; c < STATUS_PROFILE_SIZE; ++c) {
+                    status.profileTime[c] = m_pPage->profileTime[c].load(std::memory_order_relaxed);
+                }
+                status.profileTime[STATUS_PROFILE_SIZE - 1] = 0;
+
+                // the loads above can't move past the check below
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (m_pPage->sequence.load(std::memory_order_relaxed) == BEFORE)
+                    return status;
+            }
+
+            return std::nullopt;
+        }
+
+        // compare to the last read's to skip reading an unchanged page
+        uint64_t sequence() const {
+            return m_pPage ? m_pPage->sequence.load(std::memory_order_acquire) : 0;
+        }
+
+      private:
+        const SStatusPage* m_pPage = nullptr;
+    };
+}
@@ -1,43 +1,361 @@
 #include "ConfigManager.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
 #include <hyprlang.hpp>
 #include <hyprutils/path/Path.hpp>
 #include <string>
+#include <sys/inotify.h>
+#include <sys/socket.h>
 #include <sys/ucontext.h>
+#include <unistd.h>
+#include "helpers/Hash.hpp"
 #include "helpers/Log.hpp"
 
+// registered as the transition:curve default and used in place of an invalid one
+static constexpr const char* DEFAULT_TRANSITION_CURVE = "ease-in-out";
+
 static std::string getMainConfigPath() {
     static const auto paths = Hyprutils::Path::findConfig("hyprsunset");
 
     return paths.first.value_or("");
 }
 
-CConfigManager::CConfigManager(std::string configPath) :
-    m_config(configPath.empty() ? getMainConfigPath().c_str() : configPath.c_str(), Hyprlang::SConfigOptions{.throwAllErrors = true, .allowMissingConfig = true}) {
+CConfigManager::CConfigManager(std::string configPath) {
     currentConfigPath = configPath.empty() ? getMainConfigPath() : configPath;
 }
 
+CConfigManager::~CConfigManager() {
+    if (m_iWatchFD >= 0)
+        close(m_iWatchFD);
+}
+
 void CConfigManager::init() {
-    m_config.addConfigValue("max-gamma", Hyprlang::INT{100});
+    m_pConfig = createConfig();
 
-    m_config.addSpecialCategory("profile", Hyprlang::SSpecialCategoryOptions{.key = nullptr, .anonymousKeyBased = true});
-    m_config.addSpecialConfigValue("profile", "time", Hyprlang::STRING{"00:00"});
-    m_config.addSpecialConfigValue("profile", "temperature", Hyprlang::INT{6000});
-    m_config.addSpecialConfigValue("profile", "gamma", Hyprlang::FLOAT{1.0f});
-    m_config.addSpecialConfigValue("profile", "identity", Hyprlang::INT{0});
+    auto result = m_pConfig->parse();
 
-    m_config.commence();
+    if (result.error)
+        Debug::log<ERR>("Config has errors:\n{}\nProceeding ignoring faulty entries", result.getError());
 
-    auto result = m_config.parse();
+    updateWatches();
+}
 
-    if (result.error)
-        Debug::log(ERR, "Config has errors:\n{}\nProceeding ignoring faulty entries", result.getError());
+bool CConfigManager::reload() {
+    auto candidate = createConfig();
+    auto result    = candidate->parse();
+
+    // a source line may have been added even if the rest is broken
+    updateWatches();
+
+    if (result.error) {
+        Debug::log<ERR>("Config has errors:\n{}\nKeeping the running config", result.getError());
+        return false;
+    }
+
+    m_pConfig = std::move(candidate);
+
+    return true;
+}
+
+UP<Hyprlang::CConfig> CConfigManager::createConfig() {
+    auto config = makeUnique<Hyprlang::CConfig>(currentConfigPath.c_str(), Hyprlang::SConfigOptions{.throwAllErrors = true, .allowMissingConfig = true});
+
+    config->addConfigValue("max-gamma", Hyprlang::INT{100});
+    config->addConfigValue("temperature-model", Hyprlang::STRING{"approximate"});
+
+    config->addConfigValue("transition:duration", Hyprlang::INT{0});
+    config->addConfigValue("transition:curve", Hyprlang::STRING{DEFAULT_TRANSITION_CURVE});
+
+    config->addConfigValue("ipc:backlog", Hyprlang::INT{10});
+    config->addConfigValue("ipc:timeout", Hyprlang::INT{10000});
+    config->addConfigValue("ipc:coalesce", Hyprlang::INT{0});
+
+    // how far an interpolating profile's ramp moves before it's applied, kelvin and percent
+    config->addConfigValue("interpolation:temperature-step", Hyprlang::INT{20});
+    config->addConfigValue("interpolation:gamma-step", Hyprlang::INT{1});
+
+    // out of range means unset, profiles anchored to the sun need both
+    config->addConfigValue("location:latitude", Hyprlang::FLOAT{-1000.f});
+    config->addConfigValue("location:longitude", Hyprlang::FLOAT{-1000.f});
+
+    // x^exponent per channel, only on compositors without ctm control where gamma tables are used
+    config->addConfigValue("lut:exponent", Hyprlang::FLOAT{1.0f});
+
+    config->addSpecialCategory("profile", Hyprlang::SSpecialCategoryOptions{.key = nullptr, .anonymousKeyBased = true});
+    config->addSpecialConfigValue("profile", "time", Hyprlang::STRING{"00:00"});
+    config->addSpecialConfigValue("profile", "temperature", Hyprlang::INT{6000});
+    config->addSpecialConfigValue("profile", "gamma", Hyprlang::FLOAT{1.0f});
+    config->addSpecialConfigValue("profile", "identity", Hyprlang::INT{0});
+    config->addSpecialConfigValue("profile", "days", Hyprlang::STRING{""});
+    config->addSpecialConfigValue("profile", "dates", Hyprlang::STRING{""});
+    config->addSpecialConfigValue("profile", "interpolate", Hyprlang::STRING{""});
+
+    // unset values (0 / -1) follow the global state
+    config->addSpecialCategory("output", Hyprlang::SSpecialCategoryOptions{.key = "name"});
+    config->addSpecialConfigValue("output", "temperature", Hyprlang::INT{0});
+    config->addSpecialConfigValue("output", "gamma", Hyprlang::FLOAT{-1.f});
+    config->addSpecialConfigValue("output", "identity", Hyprlang::INT{-1});
+
+    config->commence();
+
+    return config;
+}
+
+static std::string_view trim(std::string_view str) {
+    while (!str.empty() && std::isspace((unsigned char)str.front()))
+        str.remove_prefix(1);
+    while (!str.empty() && std::isspace((unsigned char)str.back()))
+        str.remove_suffix(1);
+
+    return str;
+}
+
+// file and whatever it sources through "source = PATH" lines, recursively. relative paths are taken from the including file's directory, globs aren't followed
+static void collectSourced(const std::filesystem::path& file, std::vector<std::filesystem::path>& out) {
+    if (std::find(out.begin(), out.end(), file) != out.end())
+        return;
+
+    out.emplace_back(file);
+
+    std::ifstream stream(file);
+    std::string   line;
+
+    while (std::getline(stream, line)) {
+        auto view = trim(line);
+        if (!view.starts_with("source"))
+            continue;
+
+        view = trim(view.substr(6));
+        if (!view.starts_with('='))
+            continue;
+
+        // up to a trailing comment
+        auto value = trim(view.substr(1));
+        value      = trim(value.substr(0, value.find('#')));
+
+        std::string path{value};
+        if (path.empty() || path.find_first_of("*?[") != std::string::npos)
+            continue;
+
+        if (const auto HOME = getenv("HOME"); HOME && path.starts_with("~/"))
+            path = HOME + path.substr(1);
+
+        std::filesystem::path sourced = path;
+        if (sourced.is_relative())
+            sourced = file.parent_path() / sourced;
+
+        collectSourced(sourced.lexically_normal(), out);
+    }
+}
+
+// "weekdays", "weekends" or a list of days and ranges like "mon,wed-fri", empty for every day
+static std::optional<uint8_t> parseDays(std::string_view str) {
+    static constexpr std::array<std::string_view, 7> NAMES = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+    str = trim(str);
+
+    if (str.empty() || str == "all")
+        return DAYS_ALL;
+    if (str == "weekdays")
+        return DAYS_WEEKDAYS;
+    if (str == "weekends")
+        return DAYS_WEEKENDS;
+
+    const auto DAYINDEX = [](std::string_view name) -> int {
+        const auto IT = std::find(NAMES.begin(), NAMES.end(), trim(name));
+        return IT == NAMES.end() ? -1 : (int)std::distance(NAMES.begin(), IT);
+    };
+
+    uint8_t days = 0;
+
+    while (!str.empty()) {
+        const auto COMMA = str.find(',');
+        const auto ITEM  = str.substr(0, COMMA);
+        str              = COMMA == std::string_view::npos ? std::string_view{} : str.substr(COMMA + 1);
+
+        const auto DASH = ITEM.find('-');
+        const int  FROM = DAYINDEX(ITEM.substr(0, DASH));
+        const int  TO   = DASH == std::string_view::npos ? FROM : DAYINDEX(ITEM.substr(DASH + 1));
+
+        if (FROM < 0 || TO < 0)
+            return std::nullopt;
+
+        // ranges may wrap around the week, fri-mon
+        for (int day = FROM;; day = (day + 1) % 7) {
+            days |= 1 << day;
+            if (day == TO)
+                break;
+        }
+    }
+
+    return days;
+}
+
+// "MM-DD..MM-DD", both ends included, empty for every day of the year
+static std::optional<SDateRange> parseDates(std::string_view str) {
+    const auto PARSEDAY = [](std::string_view day) -> std::optional<std::chrono::month_day> {
+        const auto DASH  = day.find('-');
+        unsigned   month = 0, dayOfMonth = 0;
+
+        if (DASH == std::string_view::npos || std::from_chars(day.data(), day.data() + DASH, month).ec != std::errc{} ||
+            std::from_chars(day.data() + DASH + 1, day.data() + day.size(), dayOfMonth).ec != std::errc{})
+            return std::nullopt;
+
+        const std::chrono::month_day RESULT{std::chrono::month{month}, std::chrono::day{dayOfMonth}};
+        if (!RESULT.ok())
+            return std::nullopt;
+
+        return RESULT;
+    };
+
+    const auto SEPARATOR = str.find("..");
+    if (SEPARATOR == std::string_view::npos)
+        return std::nullopt;
+
+    const auto FROM = PARSEDAY(trim(str.substr(0, SEPARATOR)));
+    const auto TO   = PARSEDAY(trim(str.substr(SEPARATOR + 2)));
+
+    if (!FROM || !TO)
+        return std::nullopt;
+
+    return SDateRange{.from = *FROM, .to = *TO};
+}
+
+// "sunset", "sunrise+1h", "dusk - 1h30m", a bare number is minutes
+static std::optional<std::pair<eSolarEvent, std::chrono::minutes>> parseSolarTime(std::string_view str) {
+    str = trim(str);
+
+    const auto SIGN  = str.find_first_of("+-");
+    const auto EVENT = Solar::eventFromName(trim(str.substr(0, SIGN)));
+
+    if (EVENT == SOLAR_EVENT_NONE)
+        return std::nullopt;
+
+    if (SIGN == std::string_view::npos)
+        return std::pair{EVENT, std::chrono::minutes{0}};
+
+    std::string_view     rest   = trim(str.substr(SIGN + 1));
+    std::chrono::minutes offset = {};
+
+    if (rest.empty())
+        return std::nullopt;
+
+    while (!rest.empty()) {
+        unsigned   value = 0;
+        const auto RES   = std::from_chars(rest.data(), rest.data() + rest.size(), value);
+
+        if (RES.ec != std::errc{})
+            return std::nullopt;
+
+        rest = rest.substr(RES.ptr - rest.data());
+
+        if (rest.starts_with('h')) {
+            offset += std::chrono::hours{value};
+            rest.remove_prefix(1);
+        } else {
+            offset += std::chrono::minutes{value};
+            if (rest.starts_with('m'))
+                rest.remove_prefix(1);
+            else if (!rest.empty())
+                return std::nullopt;
+        }
+    }
+
+    return std::pair{EVENT, str[SIGN] == '-' ? -offset : offset};
+}
+
+void CConfigManager::updateWatches() {
+    if (currentConfigPath.empty())
+        return;
+
+    if (m_iWatchFD < 0) {
+        m_iWatchFD = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+        if (m_iWatchFD < 0) {
+            Debug::log<WARN>("Couldn't watch the config, changes will need a reload request");
+            return;
+        }
+    }
+
+    for (const auto& [wd, names] : m_mWatches) {
+        inotify_rm_watch(m_iWatchFD, wd);
+    }
+    m_mWatches.clear();
+
+    std::vector<std::filesystem::path> files;
+    collectSourced(std::filesystem::absolute(currentConfigPath).lexically_normal(), files);
+
+    for (const auto& file : files) {
+        // no IN_DELETE, a config that's gone for a moment mid save would otherwise reload as all defaults
+        const int WD = inotify_add_watch(m_iWatchFD, file.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (WD < 0) {
+            Debug::log<WARN>("Couldn't watch {}, changes to it will need a reload request", file.string());
+            continue;
+        }
+
+        m_mWatches[WD].emplace_back(file.filename().string());
+    }
+}
+
+int CConfigManager::watchFD() const {
+    return m_iWatchFD;
+}
+
+bool CConfigManager::filesChanged() {
+    alignas(inotify_event) char buffer[4096];
+    bool                        changed = false;
+
+    while (true) {
+        const auto LEN = read(m_iWatchFD, buffer, sizeof(buffer));
+        if (LEN <= 0)
+            break;
+
+        for (ssize_t offset = 0; offset < LEN;) {
+            const auto EVENT = (inotify_event*)(buffer + offset);
+            offset += sizeof(inotify_event) + EVENT->len;
+
+            if (EVENT->len == 0)
+                continue;
+
+            const auto WATCH = m_mWatches.find(EVENT->wd);
+            if (WATCH != m_mWatches.end() && std::ranges::find(WATCH->second, std::string_view{EVENT->name}) != WATCH->second.end())
+                changed = true;
+        }
+    }
+
+    return changed;
+}
+
+uint64_t CConfigManager::fingerprint(uint64_t seed) const {
+    uint64_t hash = seed;
+
+    if (currentConfigPath.empty())
+        return hash;
+
+    std::vector<std::filesystem::path> files;
+    collectSourced(std::filesystem::absolute(currentConfigPath).lexically_normal(), files);
+
+    // the path too, moving a line into a sourced file can change what it means
+    for (const auto& file : files) {
+        std::ifstream     stream(file, std::ios::binary);
+        const std::string CONTENTS{std::istreambuf_iterator<char>{stream}, std::istreambuf_iterator<char>{}};
+
+        hash = Hash::fnv1a(file.string(), hash);
+        hash = Hash::fnv1a(CONTENTS, hash);
+    }
+
+    return hash;
 }
 
 std::vector<SSunsetProfile> CConfigManager::getSunsetProfiles() {
     std::vector<SSunsetProfile> result;
 
-    auto                        keys = m_config.listKeysForSpecialCategory("profile");
+    auto                        keys = m_pConfig->listKeysForSpecialCategory("profile");
     result.reserve(keys.size());
 
     for (auto& key : keys) {
@@ -45,43 +363,82 @@ std::vector<SSunsetProfile> CConfigManager::getSunsetProfiles() {
         unsigned long temperature;
         float         gamma;
         bool          identity;
+        std::string   days, dates, interpolate;
 
         try {
-            time        = std::any_cast<Hyprlang::STRING>(m_config.getSpecialConfigValue("profile", "time", key.c_str()));
-            temperature = std::any_cast<Hyprlang::INT>(m_config.getSpecialConfigValue("profile", "temperature", key.c_str()));
-            gamma       = std::any_cast<Hyprlang::FLOAT>(m_config.getSpecialConfigValue("profile", "gamma", key.c_str()));
-            identity    = std::any_cast<Hyprlang::INT>(m_config.getSpecialConfigValue("profile", "identity", key.c_str()));
+            time        = std::any_cast<Hyprlang::STRING>(m_pConfig->getSpecialConfigValue("profile", "time", key.c_str()));
+            temperature = std::any_cast<Hyprlang::INT>(m_pConfig->getSpecialConfigValue("profile", "temperature", key.c_str()));
+            gamma       = std::any_cast<Hyprlang::FLOAT>(m_pConfig->getSpecialConfigValue("profile", "gamma", key.c_str()));
+            identity    = std::any_cast<Hyprlang::INT>(m_pConfig->getSpecialConfigValue("profile", "identity", key.c_str()));
+            days        = std::any_cast<Hyprlang::STRING>(m_pConfig->getSpecialConfigValue("profile", "days", key.c_str()));
+            dates       = std::any_cast<Hyprlang::STRING>(m_pConfig->getSpecialConfigValue("profile", "dates", key.c_str()));
+            interpolate = std::any_cast<Hyprlang::STRING>(m_pConfig->getSpecialConfigValue("profile", "interpolate", key.c_str()));
         } catch (const std::bad_any_cast& e) {
             RASSERT(false, "Failed to construct Profile: {}", e.what()); //
         } catch (const std::out_of_range& e) {
             RASSERT(false, "Missing property for Profile: {}", e.what()); //
         }
 
-        size_t separator = time.find(':');
+        size_t               separator = time.find(':');
+        eSolarEvent          anchor    = SOLAR_EVENT_NONE;
+        std::chrono::minutes offset    = {};
+
+        int                  hour = 0, minute = 0;
 
         if (separator == std::string::npos) {
-            Debug::log(ERR, "Invalid time format: {}, skipping profile {}", time, key);
+            const auto SOLAR = parseSolarTime(time);
+            if (!SOLAR) {
+                Debug::log<ERR>("Invalid time format: {} (should be HH:MM or sunrise / sunset / dawn / dusk with an optional offset), skipping profile {}", time, key);
+                continue;
+            }
+
+            anchor = SOLAR->first;
+            offset = SOLAR->second;
+        } else {
+            try {
+                hour   = std::stoi(time.substr(0, separator));
+                minute = std::stoi(time.substr(separator + 1).c_str());
+            } catch (const std::exception& e) {
+                Debug::log<ERR>("Invalid time format: {}, skipping profile {}", time, key);
+                continue;
+            }
+        }
+
+        const auto DAYS = parseDays(days);
+        if (!DAYS) {
+            Debug::log<ERR>("Invalid days: {}, skipping profile {}", days, key);
             continue;
         }
 
-        int hour = 0, minute = 0;
-        try {
-            hour   = std::stoi(time.substr(0, separator));
-            minute = std::stoi(time.substr(separator + 1).c_str());
-        } catch (const std::exception& e) {
-            Debug::log(ERR, "Invalid time format: {}, skipping profile {}", time, key);
+        const auto DATES = parseDates(dates);
+        if (!trim(dates).empty() && !DATES) {
+            Debug::log<ERR>("Invalid dates: {} (should be MM-DD..MM-DD), skipping profile {}", dates, key);
             continue;
         }
 
+        std::optional<eTransitionCurve> curve;
+        if (!trim(interpolate).empty()) {
+            curve = CTransition::curveFromString(std::string{trim(interpolate)});
+            if (!curve) {
+                Debug::log<ERR>("Invalid interpolate: {} (should be linear, ease-in, ease-out or ease-in-out), skipping profile {}", interpolate, key);
+                continue;
+            }
+        }
+
         // clang-format off
         result.push_back(SSunsetProfile{
             .time = {
                 .hour   = std::chrono::hours(hour),
                 .minute = std::chrono::minutes(minute),
             },
+            .anchor      = anchor,
+            .offset      = offset,
             .temperature = temperature,
             .gamma       = gamma,
             .identity    = identity,
+            .interpolate = curve,
+            .days        = *DAYS,
+            .dates       = DATES,
         });
         // clang-format on
     }
@@ -89,10 +446,168 @@ std::vector<SSunsetProfile> CConfigManager::getSunsetProfiles() {
     return result;
 }
 
+std::vector<SOutputRule> CConfigManager::getOutputRules() {
+    std::vector<SOutputRule> result;
+
+    auto                     keys     = m_pConfig->listKeysForSpecialCategory("output");
+    const auto               MAXGAMMA = getMaxGamma();
+    result.reserve(keys.size());
+
+    for (auto& key : keys) {
+        Hyprlang::INT   temperature;
+        Hyprlang::FLOAT gamma;
+        Hyprlang::INT   identity;
+
+        try {
+            temperature = std::any_cast<Hyprlang::INT>(m_pConfig->getSpecialConfigValue("output", "temperature", key.c_str()));
+            gamma       = std::any_cast<Hyprlang::FLOAT>(m_pConfig->getSpecialConfigValue("output", "gamma", key.c_str()));
+            identity    = std::any_cast<Hyprlang::INT>(m_pConfig->getSpecialConfigValue("output", "identity", key.c_str()));
+        } catch (const std::bad_any_cast& e) {
+            RASSERT(false, "Failed to construct output rule: {}", e.what()); //
+        } catch (const std::out_of_range& e) {
+            RASSERT(false, "Missing property for output rule: {}", e.what()); //
+        }
+
+        SOutputRule rule{.selector = key};
+
+        if (temperature > 0) {
+            if (temperature < 1000 || temperature > 20000)
+                Debug::log<ERR>("Invalid temperature {} for output {}, ignoring it", temperature, key);
+            else
+                rule.overrides.temperature = temperature;
+        }
+
+        if (gamma >= 0) {
+            if (gamma > MAXGAMMA)
+                Debug::log<ERR>("Invalid gamma {} for output {}, ignoring it", gamma, key);
+            else
+                rule.overrides.gamma = gamma;
+        }
+
+        if (identity >= 0)
+            rule.overrides.identity = identity != 0;
+
+        result.emplace_back(std::move(rule));
+    }
+
+    return result;
+}
+
+std::optional<SLocation> CConfigManager::getLocation() {
+    Hyprlang::FLOAT latitude, longitude;
+
+    try {
+        latitude  = std::any_cast<Hyprlang::FLOAT>(m_pConfig->getConfigValue("location:latitude"));
+        longitude = std::any_cast<Hyprlang::FLOAT>(m_pConfig->getConfigValue("location:longitude"));
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct location: {}", e.what()); //
+    }
+
+    if (latitude == -1000.f && longitude == -1000.f)
+        return std::nullopt;
+
+    if (latitude < -90 || latitude > 90 || longitude < -180 || longitude > 180) {
+        Debug::log<ERR>("Invalid location {}, {} (latitude should be within -90..90, longitude within -180..180), ignoring it", latitude, longitude);
+        return std::nullopt;
+    }
+
+    return SLocation{.latitude = latitude, .longitude = longitude};
+}
+
 float CConfigManager::getMaxGamma() {
     try {
-        return std::any_cast<Hyprlang::INT>(m_config.getConfigValue("max-gamma")) / 100.f;
+        return std::any_cast<Hyprlang::INT>(m_pConfig->getConfigValue("max-gamma")) / 100.f;
     } catch (const std::bad_any_cast& e) {
         RASSERT(false, "Failed to construct max-gamma: {}", e.what()); //
     }
 }
+
+eKelvinModel CConfigManager::getKelvinModel() {
+    std::string model;
+
+    try {
+        model = std::any_cast<Hyprlang::STRING>(m_pConfig->getConfigValue("temperature-model"));
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct temperature-model: {}", e.what()); //
+    }
+
+    if (model == "planckian")
+        return KELVIN_MODEL_PLANCKIAN;
+
+    if (model != "approximate")
+        Debug::log<ERR>("Invalid temperature model: {}, falling back to approximate", model);
+
+    return KELVIN_MODEL_APPROXIMATE;
+}
+
+std::chrono::milliseconds CConfigManager::getTransitionDuration() {
+    try {
+        return std::chrono::milliseconds(std::max(std::any_cast<Hyprlang::INT>(m_pConfig->getConfigValue("transition:duration")), Hyprlang::INT{0}));
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct transition:duration: {}", e.what()); //
+    }
+}
+
+eTransitionCurve CConfigManager::getTransitionCurve() {
+    std::string curve;
+
+    try {
+        curve = std::any_cast<Hyprlang::STRING>(m_pConfig->getConfigValue("transition:curve"));
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct transition:curve: {}", e.what()); //
+    }
+
+    if (const auto CURVE = CTransition::curveFromString(curve); CURVE)
+        return *CURVE;
+
+    Debug::log<ERR>("Invalid transition curve: {}, falling back to the default {}", curve, DEFAULT_TRANSITION_CURVE);
+    return *CTransition::curveFromString(DEFAULT_TRANSITION_CURVE);
+}
+
+unsigned long CConfigManager::getRampTemperatureStep() {
+    try {
+        return std::max(std::any_cast<Hyprlang::INT>(m_pConfig->getConfigValue("interpolation:temperature-step")), Hyprlang::INT{1});
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct interpolation:temperature-step: {}", e.what()); //
+    }
+}
+
+float CConfigManager::getRampGammaStep() {
+    try {
+        return std::max(std::any_cast<Hyprlang::INT>(m_pConfig->getConfigValue("interpolation:gamma-step")), Hyprlang::INT{1}) / 100.f;
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct interpolation:gamma-step: {}", e.what()); //
+    }
+}
+
+float CConfigManager::getLUTExponent() {
+    try {
+        return std::clamp(std::any_cast<Hyprlang::FLOAT>(m_pConfig->getConfigValue("lut:exponent")), 0.1f, 10.f);
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct lut:exponent: {}", e.what()); //
+    }
+}
+
+int CConfigManager::getIPCBacklog() {
+    try {
+        return std::clamp(std::any_cast<Hyprlang::INT>(m_pConfig->getConfigValue("ipc:backlog")), Hyprlang::INT{1}, Hyprlang::INT{SOMAXCONN});
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct ipc:backlog: {}", e.what()); //
+    }
+}
+
+std::chrono::milliseconds CConfigManager::getIPCTimeout() {
+    try {
+        return std::chrono::milliseconds(std::max(std::any_cast<Hyprlang::INT>(m_pConfig->getConfigValue("ipc:timeout")), Hyprlang::INT{0}));
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct ipc:timeout: {}", e.what()); //
+    }
+}
+
+std::chrono::milliseconds CConfigManager::getCoalesceWindow() {
+    try {
+        return std::chrono::milliseconds(std::max(std::any_cast<Hyprlang::INT>(m_pConfig->getConfigValue("ipc:coalesce")), Hyprlang::INT{0}));
+    } catch (const std::bad_any_cast& e) {
+        RASSERT(false, "Failed to construct ipc:coalesce: {}", e.what()); //
+    }
+}
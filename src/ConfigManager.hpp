@@ -1,22 +1,53 @@
 #pragma once
 
 #include "Hyprsunset.hpp"
+#include "Transition.hpp"
 #include <hyprlang.hpp>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 class CConfigManager {
   public:
     CConfigManager(std::string configPath);
+    ~CConfigManager();
 
     std::vector<SSunsetProfile> getSunsetProfiles();
+    std::vector<SOutputRule>    getOutputRules();
+    std::optional<SLocation>    getLocation();
     float                       getMaxGamma();
+    eKelvinModel                getKelvinModel();
+    std::chrono::milliseconds   getTransitionDuration();
+    eTransitionCurve            getTransitionCurve();
+    unsigned long               getRampTemperatureStep();
+    float                       getRampGammaStep();
+    float                       getLUTExponent();
+    int                         getIPCBacklog();
+    std::chrono::milliseconds   getIPCTimeout();
+    std::chrono::milliseconds   getCoalesceWindow();
 
     void                        init();
+    // parses the files again into a fresh config, which only replaces the current one if it has no errors
+    bool                        reload();
+
+    // inotify fd for the config and the files it sources, -1 if there's nothing to watch
+    int                         watchFD() const;
+    // drains watchFD, returns whether any of the watched files changed
+    bool                        filesChanged();
+    // of the config and everything it sources, without parsing. cheap enough for startup
+    uint64_t                    fingerprint(uint64_t seed) const;
 
   private:
-    Hyprlang::CConfig m_config;
+    UP<Hyprlang::CConfig>                             createConfig();
+    void                                              updateWatches();
+
+    UP<Hyprlang::CConfig>                             m_pConfig;
+
+    std::string                                       currentConfigPath;
 
-    std::string       currentConfigPath;
+    // watch descriptor (a directory, editors tend to replace files rather than write them) to the watched files in it
+    int                                               m_iWatchFD = -1;
+    std::unordered_map<int, std::vector<std::string>> m_mWatches;
 };
 
 inline UP<CConfigManager> g_pConfigManager;
@@ -1,111 +1,294 @@
 #include "ConfigManager.hpp"
 #include "helpers/Log.hpp"
+#include "helpers/Matrix.hpp"
+#include "helpers/Stats.hpp"
+#include "helpers/Trace.hpp"
 #include "IPCSocket.hpp"
+#include "StatusPage.hpp"
+#include "backend/CTMBackend.hpp"
+#include "backend/GammaBackend.hpp"
+#include "backend/NullBackend.hpp"
 #include <cstring>
-#include <mutex>
 #include <optional>
-#include <thread>
 #include <chrono>
-#include <sys/poll.h>
+#include <csignal>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
 #include <sys/timerfd.h>
+#include <unistd.h>
 #include <wayland-client-core.h>
 
-#define TIMESPEC_NSEC_PER_SEC 1000000000L
+#define TIMESPEC_NSEC_PER_SEC  1000000000L
+#define TRANSITION_FRAME_NSEC  (TIMESPEC_NSEC_PER_SEC / 60)
+#define HOTPLUG_WINDOW_NSEC    (TIMESPEC_NSEC_PER_SEC / 10) // docking brings up several outputs within a few frames
+#define SNAPSHOT_DELAY_NSEC    (TIMESPEC_NSEC_PER_SEC * 2)  // without commits before the snapshot is written, a transition gets one write once it ended
+#define SIMULATION_FLUSH_BYTES 65536
 
-static void registerSignalAction(int sig, void (*handler)(int), int sa_flags = 0) {
-    struct sigaction sa;
-    sa.sa_handler = handler;
-    sigemptyset(&sa.sa_mask);
-    sa.sa_flags = sa_flags;
-    sigaction(sig, &sa, nullptr);
+// drains the inotify fd, returns whether /etc/localtime was replaced
+static bool localtimeChanged(int fd) {
+    alignas(inotify_event) char buffer[4096];
+    bool                        changed = false;
+
+    while (true) {
+        const auto LEN = read(fd, buffer, sizeof(buffer));
+        if (LEN <= 0)
+            break;
+
+        for (ssize_t offset = 0; offset < LEN;) {
+            const auto EVENT = (inotify_event*)(buffer + offset);
+            if (EVENT->len > 0 && std::string_view{EVENT->name} == "localtime")
+                changed = true;
+            offset += sizeof(inotify_event) + EVENT->len;
+        }
+    }
+
+    return changed;
 }
 
-static void handleExitSignal(int sig) {
-    Debug::log(NONE, "┣ Exiting on user interrupt\n╹");
-    g_pHyprsunset->terminate();
+bool SOutput::matches(std::string_view selector) const {
+    if (selector.starts_with("desc:"))
+        return !description.empty() && description.starts_with(selector.substr(5));
+
+    return !name.empty() && selector == name;
 }
 
-static void timespecAddNs(timespec* pTimespec, int64_t delta) {
-    auto delta_ns_low = delta % TIMESPEC_NSEC_PER_SEC;
-    auto delta_s_high = delta / TIMESPEC_NSEC_PER_SEC;
+bool SOutput::applyCTM(struct SState* state) {
+    TRACE_SCOPE("applyCTM");
 
-    pTimespec->tv_sec += delta_s_high;
+    auto       arr   = fixedFromMatrix(ctm);
+    const bool CURVE = state->backend->capabilities() & BACKEND_CAPABILITY_CURVE;
 
-    pTimespec->tv_nsec += (long)delta_ns_low;
-    if (pTimespec->tv_nsec >= TIMESPEC_NSEC_PER_SEC) {
-        pTimespec->tv_nsec -= TIMESPEC_NSEC_PER_SEC;
-        ++pTimespec->tv_sec;
-    }
+    if (sent && arr == sentCtm && (!CURVE || sentExponent == state->lutExponent))
+        return false;
+
+    if (!state->backend->apply(*this, ctm, state->lutExponent))
+        return false;
+
+    sentCtm      = arr;
+    sentExponent = state->lutExponent;
+    sent         = true;
+    return true;
 }
 
-// kindly borrowed from https://tannerhelland.com/2012/09/18/convert-temperature-rgb-algorithm-code.html
-static Mat3x3 matrixForKelvin(unsigned long long temp) {
-    float r = 1.F, g = 1.F, b = 1.F;
+// the plain C api, a wrapper object per commit would mean allocating on every transition frame
+static void onCommitAck(void* data, wl_callback* callback, uint32_t) {
+    auto& state = ((CHyprsunset*)data)->state;
 
-    temp /= 100;
+    Stats::record(STAT_COMMIT_ACK, Stats::clock::now() - state.commitSent);
 
-    if (temp <= 66) {
-        r = 255;
-        g = std::clamp(99.4708025861 * std::log(temp) - 161.1195681661, 0.0, 255.0);
-        if (temp <= 19)
-            b = 0;
-        else
-            b = std::clamp(std::log(temp - 10) * 138.5177312231 - 305.0447927307, 0.0, 255.0);
-    } else {
-        r = std::clamp(329.698727446 * (std::pow(temp - 60, -0.1332047592)), 0.0, 255.0);
-        g = std::clamp(288.1221695283 * (std::pow(temp - 60, -0.0755148492)), 0.0, 255.0);
-        b = 255;
+    wl_callback_destroy(callback);
+    state.commitAck = nullptr;
+}
+
+static const wl_callback_listener COMMIT_ACK_LISTENER = {.done = onCommitAck};
+
+void CHyprsunset::commitCTMs() {
+    TRACE_SCOPE("commitCTMs");
+
+    const auto NOW = Stats::clock::now();
+
+    // the timeline starts with the process, this marks how long startup took
+    if (Stats::counters[STAT_COMMITS_SENT] == 0) {
+        Trace::instant("first commit");
+        Debug::log<LOG>("First commit {}ms after start", std::chrono::duration_cast<std::chrono::milliseconds>(NOW - Stats::start).count());
+    }
+
+    if (Stats::pendingRequest) {
+        Stats::record(STAT_REQUEST_TO_COMMIT, NOW - *Stats::pendingRequest);
+        Stats::pendingRequest.reset();
     }
 
-    return std::array<float, 9>{r / 255.F, 0, 0, 0, g / 255.F, 0, 0, 0, b / 255.F};
+    state.backend->commit();
+    Stats::count(STAT_COMMITS_SENT);
+
+    if (!state.wlDisplay)
+        return;
+
+    // the compositor answers the sync once it went through the commit, one at a time is plenty for a sample
+    if (!state.commitAck) {
+        state.commitAck  = wl_display_sync(state.wlDisplay);
+        state.commitSent = NOW;
+        wl_callback_add_listener(state.commitAck, &COMMIT_ACK_LISTENER, this);
+    }
+
+    const auto FLUSHBEGIN = Stats::clock::now();
+    wl_display_flush(state.wlDisplay);
+    Stats::record(STAT_FLUSH, Stats::clock::now() - FLUSHBEGIN);
+    Trace::complete("wl_display_flush", FLUSHBEGIN);
+
+    // no file write per transition frame, the timer saves once commits have settled. it's armed once, a late commit pushes it back when it fires
+    m_lastCommit = NOW;
+    if (!m_bSnapshotPending && state.snapshotTimerFD >= 0) {
+        armSnapshotTimer(std::chrono::nanoseconds{SNAPSHOT_DELAY_NSEC});
+        m_bSnapshotPending = true;
+    }
 }
 
-void SOutput::applyCTM(struct SState* state) {
-    auto arr = state->ctm.getMatrix();
-    state->pCTMMgr->sendSetCtmForOutput(output->resource(), wl_fixed_from_double(arr[0]), wl_fixed_from_double(arr[1]), wl_fixed_from_double(arr[2]), wl_fixed_from_double(arr[3]),
-                                        wl_fixed_from_double(arr[4]), wl_fixed_from_double(arr[5]), wl_fixed_from_double(arr[6]), wl_fixed_from_double(arr[7]),
-                                        wl_fixed_from_double(arr[8]));
+void CHyprsunset::armSnapshotTimer(std::chrono::nanoseconds delay) {
+    itimerspec ts = {.it_value = {.tv_sec = delay.count() / TIMESPEC_NSEC_PER_SEC, .tv_nsec = delay.count() % TIMESPEC_NSEC_PER_SEC}};
+    timerfd_settime(state.snapshotTimerFD, 0, &ts, nullptr);
 }
 
-void CHyprsunset::commitCTMs() {
-    g_pHyprsunset->state.pCTMMgr->sendCommit();
+void CHyprsunset::onSnapshotTimer() {
+    const auto QUIET = std::chrono::steady_clock::now() - m_lastCommit;
+
+    // still moving, wait for the rest of the delay after the latest commit
+    if (QUIET < std::chrono::nanoseconds{SNAPSHOT_DELAY_NSEC}) {
+        armSnapshotTimer(std::chrono::nanoseconds{SNAPSHOT_DELAY_NSEC} - QUIET);
+        return;
+    }
+
+    m_bSnapshotPending = false;
+    m_snapshot.save(m_iFingerprint, state);
 }
 
-int CHyprsunset::calculateMatrix() {
+int CHyprsunset::calculateMatrix(bool announce) {
+    TRACE_SCOPE("calculateMatrix");
+
     if (KELVIN < 1000 || KELVIN > 20000) {
-        Debug::log(NONE, "✖ Temperature invalid: {}. The temperature has to be between 1000 and 20000K", KELVIN);
+        Debug::log<NONE>("✖ Temperature invalid: {}. The temperature has to be between 1000 and 20000K", KELVIN);
         return 0;
     }
 
-    if (GAMMA < 0 || GAMMA > MAX_GAMMA) {
-        Debug::log(NONE, "✖ Gamma invalid: {}%. The gamma has to be between 0% and {}%", GAMMA * 100, MAX_GAMMA * 100);
+    // written so that a nan fails it too
+    if (!(GAMMA >= 0 && GAMMA <= MAX_GAMMA)) {
+        Debug::log<NONE>("✖ Gamma invalid: {}%. The gamma has to be between 0% and {}%", GAMMA * 100, MAX_GAMMA * 100);
         return 0;
     }
 
+    // calculate the matrix
+    state.ctm = buildMatrix(KELVIN, GAMMA, identity, KELVIN_MODEL);
+
+    // a ramp steps every few minutes all evening, that's no news to the user
+    if (!announce) {
+        Debug::log<TRACE>("Ramp step to {}K, gamma {}%", KELVIN, GAMMA * 100);
+        return 1;
+    }
+
     if (!identity)
-        Debug::log(NONE, "┣ Setting the temperature to {}K{}\n┃", KELVIN, kelvinSet ? "" : " (default)");
+        Debug::log<NONE>("┣ Setting the temperature to {}K{}\n┃", KELVIN, kelvinSet ? "" : " (default)");
     else
-        Debug::log(NONE, "┣ Resetting the matrix (--identity passed)\n┃", KELVIN, kelvinSet ? "" : " (default)");
-
-    // calculate the matrix
-    state.ctm = identity ? Mat3x3::identity() : matrixForKelvin(KELVIN);
-    state.ctm.multiply(std::array<float, 9>{GAMMA, 0, 0, 0, GAMMA, 0, 0, 0, GAMMA});
+        Debug::log<NONE>("┣ Resetting the matrix (--identity passed)\n┃", KELVIN, kelvinSet ? "" : " (default)");
 
-    Debug::log(NONE, "┣ Calculated the CTM to be {}\n┃", state.ctm.toString());
+    Debug::log<NONE>("┣ Calculated the CTM to be {}\n┃", state.ctm.toString());
 
     return 1;
 }
 
+bool CHyprsunset::preinit(uint64_t fingerprintSeed) {
+    if (BACKEND == BACKEND_NULL) {
+        Debug::log<NONE>("┣ Using the null backend, nothing is sent to a compositor");
+        addNullOutput();
+        return true;
+    }
+
+    if (!connect())
+        return false;
+
+    m_iFingerprintSeed = fingerprintSeed;
+    m_iFingerprint     = g_pConfigManager->fingerprint(fingerprintSeed);
+
+    if (applySnapshot())
+        Debug::log<NONE>("┣ Restored the last state while the config loads");
+
+    return true;
+}
+
+bool CHyprsunset::applySnapshot() {
+    TRACE_SCOPE("snapshot");
+
+    if (!m_snapshot.load(m_iFingerprint))
+        return false;
+
+    state.ctm         = m_snapshot.ctm();
+    state.lutExponent = m_snapshot.exponent();
+
+    for (auto& o : state.outputs | std::views::values) {
+        o->ctm       = m_snapshot.ctmFor(o->name);
+        o->targetCtm = o->ctm;
+        o->fromCtm   = o->ctm;
+    }
+
+    applyCurrentCTM();
+
+    return true;
+}
+
 int CHyprsunset::init() {
+    Debug::log<NONE>("┣ Found {} output(s), applying CTMs", state.outputs.size());
+
+    state.transitionTimerFD = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    state.coalesceTimerFD   = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    state.hotplugTimerFD    = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    state.snapshotTimerFD   = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+
+    g_pStatusPage = std::make_unique<CStatusPage>();
+
+    // anything sent before this came from the snapshot
+    const auto RESTORED = Stats::counters[STAT_COMMITS_SENT];
+
+    reload();
+
+    if (RESTORED)
+        Debug::log<LOG>("{}", Stats::counters[STAT_COMMITS_SENT] == RESTORED ? "Snapshot matches the config" : "Corrected the snapshot from the config");
+
+    state.initialized = true;
+
+    m_sEventLoopInternals.epollFD = epoll_create1(EPOLL_CLOEXEC);
+    RASSERT(m_sEventLoopInternals.epollFD >= 0, "[core] Couldn't create an epoll instance: {}", strerror(errno));
+
+    g_pIPCSocket = std::make_unique<CIPCSocket>(this);
+    g_pIPCSocket->initialize();
+
+    // handle exit signals in the loop instead of in a signal handler
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGINT);
+    sigprocmask(SIG_BLOCK, &signals, nullptr);
+    state.signalFD = signalfd(-1, &signals, SFD_CLOEXEC | SFD_NONBLOCK);
+
+    // realtime + TFD_TIMER_CANCEL_ON_SET: we get woken once per profile boundary, and right away if the clock is set (suspend, ntp, manual)
+    state.scheduleTimerFD = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC | TFD_NONBLOCK);
+
+    // timezone changes don't touch the clock, watch for /etc/localtime being replaced instead
+    state.tzWatchFD = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if (state.tzWatchFD >= 0 && inotify_add_watch(state.tzWatchFD, "/etc", IN_CREATE | IN_MOVED_TO | IN_CLOSE_WRITE) < 0) {
+        Debug::log<WARN>("Couldn't watch /etc/localtime, timezone changes will only be noticed at the next profile switch");
+        close(state.tzWatchFD);
+        state.tzWatchFD = -1;
+    }
+
+    schedule();
+    startEventLoop();
+
+    return 1;
+}
+
+void CHyprsunset::addNullOutput() {
+    state.backend = makeUnique<CNullBackend>();
+
+    // something to apply to, named like a connector so output rules can match it
+    auto o         = state.outputs.emplace(1, makeShared<SOutput>(nullptr, 1)).first->second;
+    o->name        = "NULL-1";
+    o->description = "hyprsunset null output";
+    onOutputReady(o);
+}
+
+bool CHyprsunset::connect() {
     // connect to the wayland server
     if (const auto SERVER = getenv("XDG_CURRENT_DESKTOP"); SERVER)
-        Debug::log(NONE, "┣ Running on {}", SERVER);
+        Debug::log<NONE>("┣ Running on {}", SERVER);
 
-    state.wlDisplay = wl_display_connect(nullptr);
+    {
+        TRACE_SCOPE("wl_display_connect");
+        state.wlDisplay = wl_display_connect(nullptr);
+    }
 
     if (!state.wlDisplay) {
-        Debug::log(NONE, "✖ Couldn't connect to a wayland compositor");
-        return 0;
+        Debug::log<NONE>("✖ Couldn't connect to a wayland compositor");
+        return false;
     }
 
     state.pRegistry = makeShared<CCWlRegistry>((wl_proxy*)wl_display_get_registry(state.wlDisplay));
@@ -115,220 +298,693 @@ int CHyprsunset::init() {
         if (IFACE == hyprland_ctm_control_manager_v1_interface.name) {
             auto targetVersion = std::min(version, 2u);
 
-            Debug::log(NONE, "┣ Found hyprland-ctm-control-v1 supported with version {}, binding to v{}", version, targetVersion);
+            Debug::log<NONE>("┣ Found hyprland-ctm-control-v1 supported with version {}, binding to v{}", version, targetVersion);
             state.pCTMMgr = makeShared<CCHyprlandCtmControlManagerV1>(
                 (wl_proxy*)wl_registry_bind((wl_registry*)state.pRegistry->resource(), name, &hyprland_ctm_control_manager_v1_interface, targetVersion));
 
             if (targetVersion >= 2) {
                 state.pCTMMgr->setBlocked([](CCHyprlandCtmControlManagerV1*) {
-                    Debug::log(NONE, "✖ A CTM manager is already running on the current compositor.");
+                    Debug::log<NONE>("✖ A CTM manager is already running on the current compositor.");
                     exit(1);
                 });
             }
+        } else if (IFACE == zwlr_gamma_control_manager_v1_interface.name) {
+            Debug::log<NONE>("┣ Found wlr-gamma-control-unstable-v1 supported with version {}, binding to v1", version);
+            state.pGammaMgr = makeShared<CCZwlrGammaControlManagerV1>(
+                (wl_proxy*)wl_registry_bind((wl_registry*)state.pRegistry->resource(), name, &zwlr_gamma_control_manager_v1_interface, 1));
         } else if (IFACE == wl_output_interface.name) {
-            if (std::find_if(state.outputs.begin(), state.outputs.end(), [name](const auto& el) { return el->id == name; }) != state.outputs.end())
+            if (state.outputs.contains(name))
                 return;
 
-            Debug::log(NONE, "┣ Found new output with ID {}, binding", name);
-            auto o = state.outputs.emplace_back(
-                makeShared<SOutput>(makeShared<CCWlOutput>((wl_proxy*)wl_registry_bind((wl_registry*)state.pRegistry->resource(), name, &wl_output_interface, 3)), name));
-
-            if (state.initialized) {
-                Debug::log(NONE, "┣ already initialized, applying CTM instantly");
-                o->applyCTM(&state);
-                commitCTMs();
-            }
+            // v4 for the name and description events, needed to match output rules
+            const auto TARGETVERSION = std::min(version, 4u);
+
+            Debug::log<NONE>("┣ Found new output with ID {}, binding to v{}", name, TARGETVERSION);
+            const auto WLOUTPUT = makeShared<CCWlOutput>((wl_proxy*)wl_registry_bind((wl_registry*)state.pRegistry->resource(), name, &wl_output_interface, TARGETVERSION));
+            auto       o        = state.outputs.emplace(name, makeShared<SOutput>(WLOUTPUT, name)).first->second;
+
+            o->output->setName([o = WP<SOutput>{o}](CCWlOutput*, const char* outputName) {
+                if (o)
+                    o->name = outputName;
+            });
+            o->output->setDescription([o = WP<SOutput>{o}](CCWlOutput*, const char* outputDescription) {
+                if (o)
+                    o->description = outputDescription;
+            });
+            o->output->setDone([this, o = WP<SOutput>{o}](CCWlOutput*) {
+                if (o && !o->ready)
+                    onOutputReady(o.lock());
+            });
+
+            // picked after the roundtrips at startup, it gets the outputs from then
+            if (state.backend)
+                state.backend->outputAdded(*o);
+
+            // no done event before v2
+            if (TARGETVERSION < 2)
+                onOutputReady(o);
         }
     });
 
-    state.pRegistry->setGlobalRemove([this](CCWlRegistry* r, uint32_t name) { std::erase_if(state.outputs, [name](const auto& e) { return e->id == name; }); });
+    state.pRegistry->setGlobalRemove([this](CCWlRegistry* r, uint32_t name) {
+        const auto OUTPUT = state.outputs.find(name);
+        if (OUTPUT == state.outputs.end())
+            return;
 
-    wl_display_roundtrip(state.wlDisplay);
+        Stats::count(STAT_OUTPUTS_REMOVED);
 
-    if (!state.pCTMMgr) {
-        Debug::log(NONE, "✖ Compositor doesn't support hyprland-ctm-control-v1, are you running on Hyprland?");
-        return 0;
+        if (g_pIPCSocket)
+            g_pIPCSocket->notify("outputremoved>>{}", OUTPUT->second->name);
+
+        if (state.backend)
+            state.backend->outputRemoved(*OUTPUT->second);
+
+        state.outputs.erase(OUTPUT);
+    });
+
+    // once for the globals, once more for the output metadata
+    {
+        TRACE_SCOPE("registry roundtrip");
+        wl_display_roundtrip(state.wlDisplay);
+        wl_display_roundtrip(state.wlDisplay);
     }
 
-    Debug::log(NONE, "┣ Found {} output(s), applying CTMs", state.outputs.size());
+    const bool CTM   = state.pCTMMgr && BACKEND != BACKEND_GAMMA;
+    const bool GAMMA = state.pGammaMgr && BACKEND != BACKEND_CTM;
 
-    reload();
+    if (CTM)
+        state.backend = makeUnique<CCTMBackend>(state.pCTMMgr);
+    else if (GAMMA) {
+        if (BACKEND == BACKEND_AUTO)
+            Debug::log<NONE>("┣ Compositor doesn't support hyprland-ctm-control-v1, falling back to gamma tables");
 
-    state.initialized = true;
+        state.backend = makeUnique<CGammaBackend>(state.pGammaMgr);
+    } else {
+        if (BACKEND == BACKEND_CTM)
+            Debug::log<NONE>("✖ Compositor doesn't support hyprland-ctm-control-v1, are you running on Hyprland?");
+        else if (BACKEND == BACKEND_GAMMA)
+            Debug::log<NONE>("✖ Compositor doesn't support wlr-gamma-control-unstable-v1");
+        else
+            Debug::log<NONE>("✖ Compositor supports neither hyprland-ctm-control-v1 nor wlr-gamma-control-unstable-v1");
+        return false;
+    }
 
-    g_pIPCSocket = std::make_unique<CIPCSocket>();
-    g_pIPCSocket->initialize();
+    Debug::log<NONE>("┣ Using the {} backend", state.backend->name());
 
-    registerSignalAction(SIGTERM, ::handleExitSignal);
-    registerSignalAction(SIGINT, ::handleExitSignal);
+    state.backend->onOutputUsable = [this](uint32_t id) {
+        const auto OUTPUT = state.outputs.find(id);
+        if (OUTPUT == state.outputs.end())
+            return;
 
-    state.timerFD = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        // at startup the first reload sends everything
+        OUTPUT->second->sent = false;
+        if (state.initialized && OUTPUT->second->ready)
+            queueHotplug(id);
+    };
 
-    schedule();
-    startEventLoop();
+    for (auto& o : state.outputs | std::views::values) {
+        state.backend->outputAdded(*o);
+    }
 
-    return 1;
+    // gamma sizes are sent for the new controls
+    if (GAMMA && !CTM) {
+        TRACE_SCOPE("gamma control roundtrip");
+        wl_display_roundtrip(state.wlDisplay);
+    }
+
+    return true;
+}
+
+void CHyprsunset::addPollFD(int fd, uint32_t events, std::function<void(uint32_t)> callback) {
+    if (fd < 0)
+        return;
+
+    epoll_event ev = {.events = events, .data = {.fd = fd}};
+    if (epoll_ctl(m_sEventLoopInternals.epollFD, EPOLL_CTL_ADD, fd, &ev) < 0) {
+        Debug::log<ERR>("[core] Couldn't add fd {} to the event loop: {}", fd, strerror(errno));
+        return;
+    }
+
+    m_sEventLoopInternals.callbacks[fd] = std::move(callback);
+}
+
+void CHyprsunset::updatePollFD(int fd, uint32_t events) {
+    epoll_event ev = {.events = events, .data = {.fd = fd}};
+    epoll_ctl(m_sEventLoopInternals.epollFD, EPOLL_CTL_MOD, fd, &ev);
+}
+
+void CHyprsunset::removePollFD(int fd) {
+    epoll_ctl(m_sEventLoopInternals.epollFD, EPOLL_CTL_DEL, fd, nullptr);
+    m_sEventLoopInternals.callbacks.erase(fd);
 }
 
 void CHyprsunset::startEventLoop() {
-    pollfd pollfds[] = {
-        {
-            .fd     = wl_display_get_fd(state.wlDisplay),
-            .events = POLLIN,
-        },
-        {
-            .fd     = state.timerFD,
-            .events = POLLIN,
-        },
-    };
+    // -1 without a compositor, which no event ever matches
+    const auto WLFD = state.wlDisplay ? wl_display_get_fd(state.wlDisplay) : -1;
 
-    std::thread pollThread([&]() {
-        while (1) {
-            bool preparedToRead = wl_display_prepare_read(state.wlDisplay) == 0;
-            int  ret            = 0;
+    if (WLFD >= 0) {
+        epoll_event wlEvent = {.events = EPOLLIN, .data = {.fd = WLFD}};
+        epoll_ctl(m_sEventLoopInternals.epollFD, EPOLL_CTL_ADD, WLFD, &wlEvent);
+    }
 
-            if (m_bTerminate)
-                break;
+    addPollFD(state.transitionTimerFD, EPOLLIN, [this](uint32_t) {
+        uint64_t expirations = 0;
+        if (read(state.transitionTimerFD, &expirations, sizeof(expirations)) == sizeof(expirations))
+            stepTransition();
+    });
 
-            if (preparedToRead) {
-                ret = poll(pollfds, 2, 5000);
+    addPollFD(state.coalesceTimerFD, EPOLLIN, [this](uint32_t) {
+        uint64_t expirations = 0;
+        read(state.coalesceTimerFD, &expirations, sizeof(expirations));
 
-                if (ret < 0) {
-                    RASSERT(errno == EINTR, "[core] Polling fds failed with {}", errno);
-                    wl_display_cancel_read(state.wlDisplay);
-                    continue;
-                }
+        m_sEventLoopInternals.coalescing = false;
+        if (m_sEventLoopInternals.reloadPending)
+            reload();
+    });
 
-                for (size_t i = 0; i < 2; ++i) {
-                    RASSERT(!(pollfds[i].revents & POLLHUP), "[core] Disconnected from pollfd id {}", i);
-                }
+    addPollFD(state.hotplugTimerFD, EPOLLIN, [this](uint32_t) {
+        uint64_t expirations = 0;
+        if (read(state.hotplugTimerFD, &expirations, sizeof(expirations)) == sizeof(expirations))
+            flushHotplug();
+    });
 
-                wl_display_read_events(state.wlDisplay);
-            }
+    addPollFD(state.snapshotTimerFD, EPOLLIN, [this](uint32_t) {
+        uint64_t expirations = 0;
+        if (read(state.snapshotTimerFD, &expirations, sizeof(expirations)) == sizeof(expirations))
+            onSnapshotTimer();
+    });
 
-            if (ret > 0 || !preparedToRead) {
-                Debug::log(TRACE, "[core] got poll event");
-                std::lock_guard<std::mutex> lg(m_sEventLoopInternals.loopRequestMutex);
-                m_sEventLoopInternals.shouldProcess = true;
-                m_sEventLoopInternals.loopSignal.notify_one();
-            }
-        }
+    addPollFD(state.scheduleTimerFD, EPOLLIN, [this](uint32_t) {
+        uint64_t expirations = 0;
+        if (read(state.scheduleTimerFD, &expirations, sizeof(expirations)) == sizeof(expirations))
+            handleScheduleTimer(true);
+        else if (errno == ECANCELED)
+            handleScheduleTimer(false);
     });
 
-    while (1) {
-        std::unique_lock<std::mutex> lk(m_sEventLoopInternals.loopMutex);
+    addPollFD(state.tzWatchFD, EPOLLIN, [this](uint32_t) {
+        if (localtimeChanged(state.tzWatchFD))
+            handleScheduleTimer(false);
+    });
 
-        if (!m_sEventLoopInternals.shouldProcess)
-            m_sEventLoopInternals.loopSignal.wait_for(lk, std::chrono::milliseconds(5000), [this] { return m_sEventLoopInternals.shouldProcess; });
+    addPollFD(g_pConfigManager->watchFD(), EPOLLIN, [this](uint32_t) {
+        if (g_pConfigManager->filesChanged()) {
+            Debug::log<LOG>("Config changed on disk, reloading it");
+            reloadConfig();
+        }
+    });
 
-        if (m_bTerminate)
-            break;
+    addPollFD(state.signalFD, EPOLLIN, [this](uint32_t) {
+        signalfd_siginfo info;
+        while (read(state.signalFD, &info, sizeof(info)) == sizeof(info)) {
+            Debug::log<NONE>("┣ Exiting on user interrupt\n╹");
+            terminate();
+        }
+    });
 
-        std::lock_guard<std::mutex> lg(m_sEventLoopInternals.loopRequestMutex);
+    epoll_event events[16];
 
-        m_sEventLoopInternals.shouldProcess = false;
+    while (!m_bTerminate) {
+        // events may already be queued (e.g. by a roundtrip), dispatch them before going to sleep
+        if (state.wlDisplay) {
+            while (wl_display_prepare_read(state.wlDisplay) != 0) {
+                TRACE_SCOPE("wl_display_dispatch_pending");
+                if (wl_display_dispatch_pending(state.wlDisplay) < 0)
+                    break;
+            }
 
-        if (pollfds[0].revents & POLLIN) {
-            wl_display_dispatch_pending(state.wlDisplay);
             wl_display_flush(state.wlDisplay);
         }
 
-        if (m_sEventLoopInternals.isScheduled)
-            reload();
-        else
-            tick();
+        const int COUNT = epoll_wait(m_sEventLoopInternals.epollFD, events, std::size(events), -1);
+
+        if (COUNT < 0) {
+            if (state.wlDisplay)
+                wl_display_cancel_read(state.wlDisplay);
+            RASSERT(errno == EINTR, "[core] epoll_wait failed with {}", errno);
+            continue;
+        }
+
+        // everything until the loop goes back to sleep
+        TRACE_SCOPE("poll wakeup");
+
+        bool wlReadable = false;
+        for (int i = 0; i < COUNT; ++i) {
+            if (events[i].data.fd == WLFD)
+                wlReadable = true;
+        }
+
+        if (wlReadable) {
+            TRACE_SCOPE("wl_display_dispatch_pending");
+            if (wl_display_read_events(state.wlDisplay) < 0 || wl_display_dispatch_pending(state.wlDisplay) < 0) {
+                Debug::log<ERR>("[core] Lost the connection to the compositor");
+                break;
+            }
+        } else if (state.wlDisplay)
+            wl_display_cancel_read(state.wlDisplay);
+
+        for (int i = 0; i < COUNT; ++i) {
+            if (events[i].data.fd == WLFD)
+                continue;
+
+            // looked up every time, a callback may have removed a later fd
+            const auto IT = m_sEventLoopInternals.callbacks.find(events[i].data.fd);
+            if (IT == m_sEventLoopInternals.callbacks.end())
+                continue;
 
-        m_sEventLoopInternals.isScheduled = false;
+            // the callback might remove itself
+            auto callback = IT->second;
+            callback(events[i].events);
+        }
+
+        // whatever asked for a reload during this iteration gets a single one
+        if (m_sEventLoopInternals.reloadPending && !m_sEventLoopInternals.coalescing)
+            reload();
     }
 
-    Debug::log(TRACE, "Exiting loop");
+    Debug::log<TRACE>("Exiting loop");
     m_bTerminate = true;
 
-    // cleanup wl resources
+    // what's on screen now is what the next start should restore
+    if (m_bSnapshotPending)
+        m_snapshot.save(m_iFingerprint, state);
+
+    // cleanup wl resources, the backend's go first
+    state.backend.reset();
+    if (state.commitAck)
+        wl_callback_destroy(state.commitAck);
     state.outputs.clear();
     state.pRegistry.reset();
     state.pCTMMgr.reset();
+    state.pGammaMgr.reset();
+
+    g_pIPCSocket.reset();
+    g_pStatusPage.reset();
+
+    if (state.wlDisplay)
+        wl_display_disconnect(state.wlDisplay);
+    close(state.transitionTimerFD);
+    close(state.coalesceTimerFD);
+    close(state.hotplugTimerFD);
+    close(state.snapshotTimerFD);
+    close(state.scheduleTimerFD);
+    if (state.tzWatchFD >= 0)
+        close(state.tzWatchFD);
+    if (state.signalFD >= 0)
+        close(state.signalFD);
+    close(m_sEventLoopInternals.epollFD);
+}
 
-    timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
-    timespecAddNs(&now, 1000L * 1000L * 100L);
-
-    itimerspec ts = {.it_value = now};
+void CHyprsunset::scheduleReload() {
+    m_sEventLoopInternals.reloadPending = true;
 
-    timerfd_settime(state.timerFD, TFD_TIMER_ABSTIME, &ts, nullptr);
+    if (COALESCE_WINDOW.count() <= 0 || m_sEventLoopInternals.coalescing || state.coalesceTimerFD < 0)
+        return;
 
-    pollThread.join();
+    // hold off for the window, everything arriving until then is merged into the same reload
+    const auto NS = std::chrono::duration_cast<std::chrono::nanoseconds>(COALESCE_WINDOW).count();
+    itimerspec ts = {.it_value = {.tv_sec = NS / TIMESPEC_NSEC_PER_SEC, .tv_nsec = NS % TIMESPEC_NSEC_PER_SEC}};
 
-    wl_display_disconnect(state.wlDisplay);
-    close(state.timerFD);
+    timerfd_settime(state.coalesceTimerFD, 0, &ts, nullptr);
+    m_sEventLoopInternals.coalescing = true;
 }
 
-void CHyprsunset::tick() {
-    if (g_pIPCSocket && g_pIPCSocket->mainThreadParseRequest())
-        reload();
+void CHyprsunset::reload(bool animate) {
+    m_sEventLoopInternals.reloadPending = false;
+
+    Stats::count(STAT_RELOADS);
+
+    // an invalid value (already logged) must not reach subscribers, the status page or the compositor
+    if (!calculateMatrix(animate))
+        return;
+
+    if (g_pIPCSocket)
+        g_pIPCSocket->notify("state>>{},{},{}", KELVIN, GAMMA * 100, identity);
+
+    publishStatus();
+
+    // a new lut:exponent has to go out as well, even if the matrices stay the same
+    const bool CURVE   = state.backend && (state.backend->capabilities() & BACKEND_CAPABILITY_CURVE);
+    bool       changed = false;
+
+    for (auto& o : state.outputs | std::views::values) {
+        o->fromCtm   = o->ctm;
+        o->targetCtm = matrixForOutput(*o);
+        changed      = changed || fixedFromMatrix(o->targetCtm) != fixedFromMatrix(o->ctm) || (CURVE && o->sent && o->sentExponent != state.lutExponent);
+    }
+
+    if (!state.initialized || !animate || TRANSITION_DURATION.count() <= 0) {
+        m_transition.cancel();
+        armTransitionTimer(false);
+
+        for (auto& o : state.outputs | std::views::values) {
+            o->ctm = o->targetCtm;
+        }
+
+        applyCurrentCTM();
+        return;
+    }
+
+    // already showing the targets, drop whatever was running
+    if (!changed) {
+        m_transition.cancel();
+        armTransitionTimer(false);
+
+        Stats::count(STAT_COMMITS_SKIPPED);
+        Stats::pendingRequest.reset();
+        return;
+    }
+
+    // (re)target from whatever is on screen right now
+    Debug::log<LOG>("Starting a {}ms transition", TRANSITION_DURATION.count());
+    m_transition.start(TRANSITION_DURATION, TRANSITION_CURVE);
+    armTransitionTimer(true);
 }
 
-void CHyprsunset::reload() {
-    calculateMatrix();
+bool CHyprsunset::applyCurrentCTM() {
+    bool sent = false;
 
-    for (auto& o : state.outputs) {
-        o->applyCTM(&state);
+    for (auto& o : state.outputs | std::views::values) {
+        if (o->ready && o->applyCTM(&state))
+            sent = true;
+    }
+
+    // nothing changed on any output, don't make the compositor redo its state
+    if (!sent) {
+        Debug::log<LOG>("CTMs unchanged, skipping the commit");
+
+        Stats::count(STAT_COMMITS_SKIPPED);
+        Stats::pendingRequest.reset();
+        return false;
     }
 
     commitCTMs();
 
-    wl_display_flush(state.wlDisplay);
+    return true;
+}
+
+Mat3x3 CHyprsunset::matrixForOutput(const SOutput& output) const {
+    if (!output.overrides.temperature && !output.overrides.gamma && !output.overrides.identity)
+        return state.ctm;
+
+    return buildMatrix(kelvinFor(output), gammaFor(output), identityFor(output), KELVIN_MODEL);
+}
+
+unsigned long long CHyprsunset::kelvinFor(const SOutput& output) const {
+    return output.overrides.temperature.value_or(KELVIN);
+}
+
+float CHyprsunset::gammaFor(const SOutput& output) const {
+    return output.overrides.gamma.value_or(GAMMA);
+}
+
+bool CHyprsunset::identityFor(const SOutput& output) const {
+    return output.overrides.identity.value_or(identity);
+}
+
+std::vector<SP<SOutput>> CHyprsunset::findOutputs(std::string_view selector) {
+    std::vector<SP<SOutput>> result;
+
+    if (selector.empty())
+        return result;
+
+    for (const auto& o : state.outputs | std::views::values) {
+        if (o->ready && o->matches(selector))
+            result.emplace_back(o);
+    }
+
+    return result;
+}
+
+void CHyprsunset::resetOutputOverrides() {
+    for (auto& o : state.outputs | std::views::values) {
+        o->overrides = {};
+
+        const auto RULE = std::find_if(outputRules.begin(), outputRules.end(), [&o](const auto& rule) { return o->matches(rule.selector); });
+        if (RULE != outputRules.end())
+            o->overrides = RULE->overrides;
+    }
+}
+
+void CHyprsunset::onOutputReady(SP<SOutput> output) {
+    output->ready = true;
+
+    const auto RULE = std::find_if(outputRules.begin(), outputRules.end(), [&output](const auto& rule) { return output->matches(rule.selector); });
+    if (RULE != outputRules.end()) {
+        output->overrides = RULE->overrides;
+        Debug::log<NONE>("┣ Output {} ({}) matches rule {}", output->name, output->id, RULE->selector);
+    }
+
+    if (!state.initialized)
+        return;
+
+    output->ctm       = matrixForOutput(*output);
+    output->targetCtm = output->ctm;
+    output->fromCtm   = output->ctm;
+
+    Debug::log<NONE>("┣ already initialized, applying CTM with the next hotplug batch");
+
+    Stats::count(STAT_OUTPUTS_ADDED);
+
+    if (g_pIPCSocket)
+        g_pIPCSocket->notify("outputadded>>{}", output->name);
+
+    queueHotplug(output->id);
+}
+
+void CHyprsunset::queueHotplug(uint32_t id) {
+    auto&      pending = m_sEventLoopInternals.hotplugPending;
+    const bool ARM     = pending.empty();
+
+    if (std::ranges::find(pending, id) == pending.end())
+        pending.emplace_back(id);
+
+    if (state.hotplugTimerFD < 0) {
+        flushHotplug();
+        return;
+    }
+
+    // the window starts with the first output, later ones don't push it back
+    if (!ARM)
+        return;
+
+    itimerspec ts = {.it_value = {.tv_sec = 0, .tv_nsec = HOTPLUG_WINDOW_NSEC}};
+    timerfd_settime(state.hotplugTimerFD, 0, &ts, nullptr);
+}
+
+void CHyprsunset::flushHotplug() {
+    bool sent = false;
+
+    // outputs that went away again in the window are simply gone from the map
+    for (const auto ID : m_sEventLoopInternals.hotplugPending) {
+        const auto OUTPUT = state.outputs.find(ID);
+        if (OUTPUT != state.outputs.end() && OUTPUT->second->ready && OUTPUT->second->applyCTM(&state))
+            sent = true;
+    }
+
+    Debug::log<LOG>("Applying {} hotplugged output(s)", m_sEventLoopInternals.hotplugPending.size());
+    m_sEventLoopInternals.hotplugPending.clear();
+
+    if (sent)
+        commitCTMs();
+}
+
+void CHyprsunset::stepTransition() {
+    if (!m_transition.active()) {
+        armTransitionTimer(false);
+        return;
+    }
+
+    const float PROGRESS = m_transition.progress(CTransition::clock::now());
+    bool        landed   = !m_transition.active();
+
+    for (auto& o : state.outputs | std::views::values) {
+        o->ctm = landed ? o->targetCtm : CTransition::interpolate(o->fromCtm, o->targetCtm, PROGRESS);
+    }
+
+    // the rest of the curve wouldn't change a single fixed value anymore
+    if (!landed)
+        landed = std::ranges::all_of(state.outputs | std::views::values, [](const auto& o) { return fixedFromMatrix(o->ctm) == fixedFromMatrix(o->targetCtm); });
+
+    if (landed) {
+        for (auto& o : state.outputs | std::views::values) {
+            o->ctm = o->targetCtm;
+        }
+
+        m_transition.cancel();
+        armTransitionTimer(false);
+        Debug::log<LOG>("Transition finished");
+    }
+
+    // only outputs whose fixed values changed are sent
+    if (applyCurrentCTM() && g_pIPCSocket)
+        g_pIPCSocket->notify("transition>>{}", landed ? 100 : (int)(PROGRESS * 100));
+}
+
+void CHyprsunset::armTransitionTimer(bool arm) {
+    if (state.transitionTimerFD < 0)
+        return;
+
+    itimerspec ts = {};
+    if (arm) {
+        ts.it_interval = {.tv_sec = 0, .tv_nsec = TRANSITION_FRAME_NSEC};
+        ts.it_value    = ts.it_interval;
+    }
+
+    timerfd_settime(state.transitionTimerFD, 0, &ts, nullptr);
 }
 
 void CHyprsunset::loadCurrentProfile() {
-    profiles  = g_pConfigManager->getSunsetProfiles();
-    MAX_GAMMA = g_pConfigManager->getMaxGamma();
+    m_schedule.setZone(TIMEZONE);
+    m_schedule.setLocation(g_pConfigManager->getLocation());
+    setProfiles(g_pConfigManager->getSunsetProfiles());
 
-    Debug::log(NONE, "┣ Loaded {} profiles", profiles.size());
+    MAX_GAMMA             = g_pConfigManager->getMaxGamma();
+    TRANSITION_DURATION   = g_pConfigManager->getTransitionDuration();
+    TRANSITION_CURVE      = g_pConfigManager->getTransitionCurve();
+    KELVIN_MODEL          = g_pConfigManager->getKelvinModel();
+    outputRules           = g_pConfigManager->getOutputRules();
+    COALESCE_WINDOW       = g_pConfigManager->getCoalesceWindow();
+    RAMP_TEMPERATURE_STEP = g_pConfigManager->getRampTemperatureStep();
+    RAMP_GAMMA_STEP       = g_pConfigManager->getRampGammaStep();
+    state.lutExponent     = g_pConfigManager->getLUTExponent();
 
-    std::sort(profiles.begin(), profiles.end(), [](const auto& a, const auto& b) {
-        if (a.time.hour < b.time.hour)
-            return true;
-        else if (a.time.hour > b.time.hour)
-            return false;
-        else
-            return a.time.minute < b.time.minute;
-    });
+    resetOutputOverrides();
 
-    int current = g_pHyprsunset->currentProfile();
+    Debug::log<NONE>("┣ Loaded {} profiles", m_schedule.profiles().size());
 
-    if (current == -1)
+    const auto SAMPLE = m_schedule.sample(now());
+    m_iActiveProfile  = SAMPLE ? SAMPLE->profile : -1;
+
+    if (!SAMPLE)
         return;
 
-    SSunsetProfile profile = g_pHyprsunset->profiles[current];
-    KELVIN                 = profile.temperature;
-    GAMMA                  = profile.gamma;
-    identity               = profile.identity;
+    KELVIN   = SAMPLE->temperature;
+    GAMMA    = SAMPLE->gamma;
+    identity = SAMPLE->identity;
 
-    Debug::log(NONE, "┣ Applying profile from: {}:{}", profile.time.hour.count(), profile.time.minute.count());
+    Debug::log<NONE>("┣ Applying profile from: {}", m_schedule.profiles()[SAMPLE->profile].timeString());
 }
 
-int CHyprsunset::currentProfile() {
-    if (profiles.empty())
-        return -1;
-    else if (profiles.size() == 1)
-        return 0;
+void CHyprsunset::applyCLIOverrides(bool values) {
+    if (cliOverrides.maxGamma)
+        MAX_GAMMA = *cliOverrides.maxGamma;
+
+    if (!values)
+        return;
+
+    if (cliOverrides.kelvin) {
+        KELVIN    = *cliOverrides.kelvin;
+        kelvinSet = true;
+        identity  = false;
+    }
+
+    if (cliOverrides.gamma)
+        GAMMA = *cliOverrides.gamma;
+
+    if (cliOverrides.identity)
+        identity = true;
+}
+
+bool CHyprsunset::reloadConfig() {
+    if (!g_pConfigManager->reload())
+        return false;
 
-    auto now = std::chrono::zoned_time(std::chrono::current_zone(), std::chrono::system_clock::now()).get_local_time();
+    m_iFingerprint = g_pConfigManager->fingerprint(m_iFingerprintSeed);
 
-    for (size_t i = 0; i < profiles.size(); ++i) {
-        const auto& p = profiles[i];
+    const auto NOW       = now();
+    const auto BEFORE    = m_schedule.sample(NOW);
+    const auto PROFILES  = g_pConfigManager->getSunsetProfiles();
+    const auto LOCATION  = g_pConfigManager->getLocation();
+    const auto RULES     = g_pConfigManager->getOutputRules();
+    const auto MODEL     = g_pConfigManager->getKelvinModel();
+    const auto RAMPTEMP  = g_pConfigManager->getRampTemperatureStep();
+    const auto RAMPGAMMA = g_pConfigManager->getRampGammaStep();
+    const auto EXPONENT  = g_pConfigManager->getLUTExponent();
 
-        auto        time = std::chrono::floor<std::chrono::days>(now) + p.time.hour + p.time.minute;
+    MAX_GAMMA           = g_pConfigManager->getMaxGamma();
+    TRANSITION_DURATION = g_pConfigManager->getTransitionDuration();
+    TRANSITION_CURVE    = g_pConfigManager->getTransitionCurve();
+    COALESCE_WINDOW     = g_pConfigManager->getCoalesceWindow();
 
-        if (time >= now) {
-            if (i == 0)
-                return profiles.size() - 1;
-            return i - 1;
+    applyCLIOverrides(false);
+
+    bool dirty = false;
+
+    if (MODEL != KELVIN_MODEL) {
+        KELVIN_MODEL = MODEL;
+        dirty        = true;
+    }
+
+    if (EXPONENT != state.lutExponent) {
+        state.lutExponent = EXPONENT;
+        dirty             = true;
+    }
+
+    // resets what IPC set per output, only worth it if the rules did change
+    if (RULES != outputRules) {
+        outputRules = RULES;
+        resetOutputOverrides();
+        dirty = true;
+    }
+
+    // an untouched schedule keeps its index and its timer
+    if (PROFILES != m_schedule.profiles() || LOCATION != m_schedule.location() || RAMPTEMP != RAMP_TEMPERATURE_STEP || RAMPGAMMA != RAMP_GAMMA_STEP) {
+        m_schedule.setLocation(LOCATION);
+        setProfiles(PROFILES);
+        RAMP_TEMPERATURE_STEP = RAMPTEMP;
+        RAMP_GAMMA_STEP       = RAMPGAMMA;
+
+        // edits to profiles that aren't active don't throw away what IPC set
+        const auto AFTER = m_schedule.sample(NOW);
+        if (AFTER && (!BEFORE || AFTER->temperature != BEFORE->temperature || AFTER->gamma != BEFORE->gamma || AFTER->identity != BEFORE->identity)) {
+            KELVIN   = AFTER->temperature;
+            GAMMA    = AFTER->gamma;
+            identity = AFTER->identity;
+            dirty    = true;
+
+            // same as at startup, the profile doesn't get to override the command line
+            applyCLIOverrides();
         }
+
+        m_iActiveProfile = AFTER ? AFTER->profile : -1;
+
+        Debug::log<LOG>("Profiles changed, {} loaded", m_schedule.profiles().size());
+        schedule();
     }
 
-    return profiles.size() - 1;
+    // a lower max-gamma takes everything above it down with it, calculateMatrix would refuse the old values
+    if (GAMMA > MAX_GAMMA) {
+        GAMMA = MAX_GAMMA;
+        dirty = true;
+    }
+
+    for (auto& o : state.outputs | std::views::values) {
+        if (o->overrides.gamma && *o->overrides.gamma > MAX_GAMMA) {
+            o->overrides.gamma = MAX_GAMMA;
+            dirty              = true;
+        }
+    }
+
+    Debug::log<NONE>("┣ Reloaded the config");
+
+    // the skip path in applyCurrentCTM takes care of a matrix that came out the same
+    if (dirty)
+        reload();
+
+    return true;
+}
+
+void CHyprsunset::setProfiles(std::vector<SSunsetProfile> newProfiles) {
+    m_schedule.setProfiles(std::move(newProfiles));
+}
+
+int CHyprsunset::currentProfile() {
+    return m_schedule.current(now());
+}
+
+std::optional<std::chrono::sys_seconds> CHyprsunset::nextTransition() const {
+    return m_nextTransition;
 }
 
 std::optional<SSunsetProfile> CHyprsunset::getCurrentProfile() {
@@ -336,54 +992,228 @@ std::optional<SSunsetProfile> CHyprsunset::getCurrentProfile() {
     if (current < 0)
         return std::nullopt;
 
-    return profiles[current];
+    return m_schedule.profiles()[current];
 }
 
 void CHyprsunset::schedule() {
-    std::thread([&]() {
-        while (true) {
-            int current = currentProfile();
-            if (current == -1)
-                break;
+    itimerspec ts   = {};
+    const auto NOW  = now();
+    const auto NEXT = m_schedule.next(NOW);
+    const auto WAKE = m_schedule.nextChange(NOW, RAMP_TEMPERATURE_STEP, RAMP_GAMMA_STEP);
 
-            SSunsetProfile nextProfile = (size_t)current == profiles.size() - 1 ? profiles[0] : profiles[current + 1];
+    const auto PREVIOUS = m_nextTransition;
 
-            auto           now  = std::chrono::zoned_time(std::chrono::current_zone(), std::chrono::system_clock::now()).get_local_time();
-            auto           time = std::chrono::floor<std::chrono::days>(now) + nextProfile.time.hour + nextProfile.time.minute;
+    if (!NEXT || !WAKE) {
+        m_nextTransition.reset();
+        m_nextWake.reset();
+        m_bRampStep = false;
 
-            if (now >= time)
-                time += std::chrono::days(1);
+        if (PREVIOUS)
+            publishStatus();
 
-            while (time >= std::chrono::zoned_time(std::chrono::current_zone(), std::chrono::system_clock::now()).get_local_time() + std::chrono::minutes(1))
-                std::this_thread::sleep_for(std::chrono::minutes(1));
+        if (state.scheduleTimerFD >= 0)
+            timerfd_settime(state.scheduleTimerFD, 0, &ts, nullptr);
+        return;
+    }
 
-            auto system_time = std::chrono::zoned_time{std::chrono::current_zone(), time}.get_sys_time();
+    const auto& [AT, PROFILE] = *NEXT;
+    const auto  NS            = std::chrono::duration_cast<std::chrono::nanoseconds>(WAKE->time_since_epoch()).count();
 
-            std::this_thread::sleep_until(system_time);
+    m_nextTransition = AT;
+    m_nextWake       = *WAKE;
+    m_bRampStep      = *WAKE < AT;
 
-            int newcurrent = currentProfile();
-            if (newcurrent == -1)
-                break;
+    if (PREVIOUS != m_nextTransition)
+        publishStatus();
 
-            SSunsetProfile              newProfile = profiles[newcurrent];
+    // simulate() steps to m_nextWake itself
+    if (state.scheduleTimerFD < 0)
+        return;
 
-            std::lock_guard<std::mutex> lg(m_sEventLoopInternals.loopRequestMutex);
-            KELVIN   = newProfile.temperature;
-            GAMMA    = newProfile.gamma;
-            identity = newProfile.identity;
+    ts.it_value = {.tv_sec = NS / TIMESPEC_NSEC_PER_SEC, .tv_nsec = NS % TIMESPEC_NSEC_PER_SEC};
 
-            Debug::log(NONE, "┣ Switched to new profile from: {}:{}", newProfile.time.hour.count(), newProfile.time.minute.count());
+    if (timerfd_settime(state.scheduleTimerFD, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &ts, nullptr) < 0) {
+        Debug::log<ERR>("Couldn't arm the schedule timer: {}", strerror(errno));
+        return;
+    }
 
-            m_sEventLoopInternals.shouldProcess = true;
-            m_sEventLoopInternals.isScheduled   = true;
-            m_sEventLoopInternals.loopSignal.notify_all();
-        };
-    }).detach();
+    // every ramp step would repeat the same line
+    if (m_bRampStep)
+        return;
+
+    const auto& NEXTPROFILE = m_schedule.profiles()[PROFILE];
+    Debug::log<LOG>("Next profile switch at {:%H:%M} ({})", std::chrono::zoned_time{m_schedule.zone(), AT}, NEXTPROFILE.timeString());
 }
 
-void CHyprsunset::terminate() {
-    m_sEventLoopInternals.shouldProcess = true;
-    m_sEventLoopInternals.loopSignal.notify_all();
+void CHyprsunset::handleScheduleTimer(bool boundary) {
+    TRACE_SCOPE("schedule timer");
+
+    // the index was built for the old offset
+    if (!boundary) {
+        Debug::log<LOG>("System clock or timezone changed, re-evaluating the schedule");
+        m_schedule.invalidate();
+    }
+
+    Stats::count(STAT_SCHEDULE_WAKEUPS);
+
+    const auto SAMPLE = m_schedule.sample(now());
+
+    // a clock change only matters if it moved us into another profile, don't throw away IPC changes otherwise
+    if (SAMPLE && (boundary || SAMPLE->profile != m_iActiveProfile)) {
+        const bool SWITCHED = !(boundary && m_bRampStep) || SAMPLE->profile != m_iActiveProfile;
+
+        KELVIN           = SAMPLE->temperature;
+        GAMMA            = SAMPLE->gamma;
+        identity         = SAMPLE->identity;
+        m_iActiveProfile = SAMPLE->profile;
+
+        if (SWITCHED) {
+            const auto& PROFILE = m_schedule.profiles()[SAMPLE->profile];
+
+            Debug::log<NONE>("┣ Switched to new profile from: {}", PROFILE.timeString());
 
+            if (g_pIPCSocket)
+                g_pIPCSocket->notify("profile>>{}", PROFILE.timeString());
+        }
+
+        reload(SWITCHED);
+    }
+
+    schedule();
+}
+
+void CHyprsunset::publishStatus() {
+    if (!g_pStatusPage)
+        return;
+
+    Hyprsunset::SStatus status{
+        .temperature    = (uint32_t)KELVIN,
+        .gamma          = GAMMA,
+        .identity       = identity,
+        .profile        = m_iActiveProfile,
+        .nextTransition = m_nextTransition ? m_nextTransition->time_since_epoch().count() : 0,
+    };
+
+    if (m_iActiveProfile >= 0)
+        m_schedule.profiles()[m_iActiveProfile].timeString().copy(status.profileTime, Hyprsunset::STATUS_PROFILE_SIZE - 1);
+
+    g_pStatusPage->publish(status);
+}
+
+std::chrono::system_clock::time_point CHyprsunset::now() const {
+    return m_simulatedNow ? *m_simulatedNow : std::chrono::system_clock::now();
+}
+
+static void writeAll(int fd, std::string_view data) {
+    while (!data.empty()) {
+        const auto LEN = write(fd, data.data(), data.size());
+        if (LEN < 0 && errno == EINTR)
+            continue;
+        if (LEN <= 0)
+            return;
+
+        data.remove_prefix(LEN);
+    }
+}
+
+int CHyprsunset::simulate(std::chrono::sys_seconds from, std::chrono::sys_seconds to, eSimulationFormat format) {
+    const auto BEGIN = std::chrono::steady_clock::now();
+    const auto ZONE  = m_schedule.zone();
+
+    // transitions take milliseconds, at this scale only the values they end at matter
+    TRANSITION_DURATION = std::chrono::milliseconds{0};
+    COALESCE_WINDOW     = std::chrono::milliseconds{0};
+    m_simulatedNow      = from;
+
+    addNullOutput();
+    const auto BACKEND = (CNullBackend*)state.backend.get();
+
+    // where the schedule stands at from, like loadCurrentProfile for the real clock
+    const auto START = m_schedule.sample(now());
+    m_iActiveProfile = START ? START->profile : -1;
+
+    if (START) {
+        KELVIN   = START->temperature;
+        GAMMA    = START->gamma;
+        identity = START->identity;
+    }
+
+    reload(false);
+    state.initialized = true;
+    schedule();
+
+    std::string out;
+    const auto  INSERTER = std::back_inserter(out);
+    uint64_t    rows     = 0;
+
+    const auto  ROW = [&](std::string_view event, bool committed) {
+        const auto AT      = std::chrono::floor<std::chrono::seconds>(now());
+        const auto LOCAL   = std::chrono::zoned_time{ZONE, AT};
+        const auto PROFILE = m_iActiveProfile >= 0 ? m_schedule.profiles()[m_iActiveProfile].timeString() : std::string{};
+
+        if (format == SIMULATION_FORMAT_JSON) {
+            std::format_to(INSERTER, R"({}{{"time":"{:%FT%T%z}","utc":{},"event":"{}","profile":)", rows ? "," : "", LOCAL, AT.time_since_epoch().count(), event);
+            if (PROFILE.empty())
+                out += "null";
+            else
+                std::format_to(INSERTER, R"("{}")", PROFILE);
+            std::format_to(INSERTER, R"(,"temperature":{},"gamma":{},"identity":{},"committed":{}}})", KELVIN, GAMMA * 100, identity, committed);
+        } else
+            std::format_to(INSERTER, "{:%FT%T%z},{},{},{},{},{},{},{}\n", LOCAL, AT.time_since_epoch().count(), event, PROFILE, KELVIN, GAMMA * 100, identity, committed);
+
+        ++rows;
+
+        if (out.size() >= SIMULATION_FLUSH_BYTES) {
+            writeAll(STDOUT_FILENO, out);
+            out.clear();
+        }
+    };
+
+    if (format == SIMULATION_FORMAT_JSON)
+        std::format_to(INSERTER, R"({{"zone":"{}","from":{},"to":{},"timeline":[)", ZONE->name(), from.time_since_epoch().count(), to.time_since_epoch().count());
+    else
+        out += "time,utc,event,profile,temperature,gamma,identity,committed\n";
+
+    ROW("start", BACKEND->commits() > 0);
+
+    // the same path the schedule timer takes, only the clock jumps instead of sleeping
+    uint64_t wakeups = 0;
+    while (m_nextWake && *m_nextWake < to) {
+        // nextChange is always after now, anything else would never get to the end
+        if (*m_nextWake <= now()) {
+            Debug::log<ERR>("The schedule didn't move past {}, stopping the simulation", std::chrono::floor<std::chrono::seconds>(now()));
+            break;
+        }
+
+        m_simulatedNow = *m_nextWake;
+
+        const bool RAMP    = m_bRampStep;
+        const auto COMMITS = BACKEND->commits();
+
+        handleScheduleTimer(true);
+        ++wakeups;
+
+        ROW(RAMP ? "ramp" : "switch", BACKEND->commits() != COMMITS);
+    }
+
+    const double DAYS = std::chrono::duration<double, std::chrono::days::period>(to - from).count();
+    const double RATE = DAYS > 0 ? wakeups / DAYS : 0;
+
+    if (format == SIMULATION_FORMAT_JSON)
+        std::format_to(INSERTER, R"(],"wakeups":{},"wakeups_per_day":{:.2f},"commits":{}}})" "\n", wakeups, RATE, BACKEND->commits());
+
+    writeAll(STDOUT_FILENO, out);
+
+    const auto ELAPSED = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - BEGIN);
+    Debug::log<NONE>("┣ Simulated {:.1f} days in {} within {}ms: {} wakeups ({:.2f} per day), {} commits", DAYS, ZONE->name(), ELAPSED.count(), wakeups, RATE,
+                     BACKEND->commits());
+    Debug::log<NONE>("╹");
+
+    state.backend.reset();
+
+    return 1;
+}
+
+void CHyprsunset::terminate() {
     m_bTerminate = true;
 }
@@ -1,12 +1,23 @@
+#pragma once
+
 #include <cmath>
 #include <sys/signal.h>
 #include <wayland-client.h>
 #include <vector>
-#include <mutex>
+#include <array>
+#include <functional>
+#include <map>
+#include <ranges>
 #include <optional>
-#include <condition_variable>
+#include <unordered_map>
 #include "protocols/hyprland-ctm-control-v1.hpp"
 #include "protocols/wayland.hpp"
+#include "protocols/wlr-gamma-control-unstable-v1.hpp"
+#include "ProfileSchedule.hpp"
+#include "Snapshot.hpp"
+#include "Transition.hpp"
+#include "backend/IOutputBackend.hpp"
+#include "helpers/Kelvin.hpp"
 
 #include <hyprutils/math/Mat3x3.hpp>
 #include <hyprutils/memory/WeakPtr.hpp>
@@ -16,31 +27,71 @@ using namespace Hyprutils::Memory;
 #define SP CSharedPointer
 #define WP CWeakPointer
 
+enum eSimulationFormat : uint8_t {
+    SIMULATION_FORMAT_CSV = 0,
+    SIMULATION_FORMAT_JSON,
+};
+
+// per-output replacements for the global values, unset ones follow the global state
+struct SOutputOverride {
+    std::optional<unsigned long long> temperature;
+    std::optional<float>              gamma;
+    std::optional<bool>               identity;
+
+    bool                              operator==(const SOutputOverride&) const = default;
+};
+
+// an output block from the config
+struct SOutputRule {
+    std::string     selector;
+    SOutputOverride overrides;
+
+    bool            operator==(const SOutputRule&) const = default;
+};
+
 struct SOutput {
-    SP<CCWlOutput> output;
-    uint32_t       id = 0;
-    void           applyCTM(struct SState*);
+    SP<CCWlOutput>            output; // null on the null backend
+    uint32_t                  id = 0;
+    std::string               name, description;
+    bool                      ready = false; // got the first done event, name and description are known
+
+    SOutputOverride           overrides;
+
+    Mat3x3                    ctm;       // shown right now
+    Mat3x3                    targetCtm; // what ctm is transitioning towards
+    Mat3x3                    fromCtm;   // where the running transition started
+
+    std::array<wl_fixed_t, 9> sentCtm      = {};
+    float                     sentExponent = 1.0f;
+    bool                      sent         = false;
+
+    // "NAME" or "desc:DESCRIPTION PREFIX"
+    bool matches(std::string_view selector) const;
+    // returns whether ctm had to be sent, i.e. differs from what the backend has
+    bool applyCTM(struct SState*);
 };
 
 struct SState {
     SP<CCWlRegistry>                  pRegistry;
     SP<CCHyprlandCtmControlManagerV1> pCTMMgr;
-    wl_display*                       wlDisplay = nullptr;
-    std::vector<SP<SOutput>>          outputs;
+    SP<CCZwlrGammaControlManagerV1>   pGammaMgr;
+    UP<IOutputBackend>                backend;
+    wl_display*                       wlDisplay = nullptr; // null on the null backend
+    std::map<uint32_t, SP<SOutput>>   outputs;             // by registry name, the null output is 1
     bool                              initialized = false;
-    Mat3x3                            ctm;
-    int                               timerFD = -1;
-};
-
-struct SSunsetProfile {
-    struct {
-        std::chrono::hours   hour;
-        std::chrono::minutes minute;
-    } time;
+    Mat3x3                            ctm;                      // global matrix, used by outputs without overrides
+    float                             lutExponent       = 1.0f; // curve on top of the matrix, for backends with BACKEND_CAPABILITY_CURVE
+    int                               transitionTimerFD = -1;
+    int                               coalesceTimerFD   = -1;
+    int                               hotplugTimerFD    = -1;
+    int                               snapshotTimerFD   = -1;
+    int                               scheduleTimerFD   = -1;
+    int                               tzWatchFD         = -1;
+    int                               signalFD          = -1;
 
-    unsigned long temperature = 6000;
-    float         gamma       = 1.0f;
-    bool          identity    = false;
+    // sync after the last commit we're waiting on, for the ack delay stat
+    wl_callback*                          commitAck = nullptr;
+    std::chrono::steady_clock::time_point commitSent;
 };
 
 class CHyprsunset {
@@ -49,33 +100,116 @@ class CHyprsunset {
     float                         GAMMA     = 1.0f; // default
     unsigned long long            KELVIN    = 6000; // default
     bool                          kelvinSet = false, identity = false;
+    std::chrono::milliseconds     TRANSITION_DURATION{0};
+    eTransitionCurve              TRANSITION_CURVE = CURVE_EASE_IN_OUT;
+    eKelvinModel                  KELVIN_MODEL     = KELVIN_MODEL_APPROXIMATE;
+    std::chrono::milliseconds     COALESCE_WINDOW{0};
+    unsigned long                 RAMP_TEMPERATURE_STEP = 20;
+    float                         RAMP_GAMMA_STEP       = 0.01f;
+    eBackendType                  BACKEND               = BACKEND_AUTO;
+    const std::chrono::time_zone* TIMEZONE              = nullptr; // the system's if unset
     SState                        state;
     bool                          m_bTerminate = false;
 
-    int                           calculateMatrix();
+    // from the command line, they win over the config on every load
+    struct {
+        std::optional<unsigned long long> kelvin;
+        std::optional<float>              gamma;
+        std::optional<float>              maxGamma;
+        bool                              identity = false;
+    } cliOverrides;
+
+    // announce = false logs a single trace line instead of the new values and matrix, for ramp steps
+    int                           calculateMatrix(bool announce = true);
+    // the backend, the outputs and the snapshot's matrices on them, before the config is parsed. fingerprintSeed is mixed into the config's
+    bool                          preinit(uint64_t fingerprintSeed);
     int                           init();
-    void                          tick();
+    // runs the schedule from..to against a virtual clock on the null backend and prints every wakeup to stdout, no event loop
+    int                           simulate(std::chrono::sys_seconds from, std::chrono::sys_seconds to, eSimulationFormat format);
+    void                          scheduleReload();
     void                          loadCurrentProfile();
+    // puts cliOverrides back on top of what the config set, values = false only restores the max gamma
+    void                          applyCLIOverrides(bool values = true);
+    // re-reads the config, only what changed is re-applied. false if the new config has errors, nothing changes then
+    bool                          reloadConfig();
     std::optional<SSunsetProfile> getCurrentProfile();
     void                          terminate();
 
+    // sorts them by time, doesn't apply anything
+    void                          setProfiles(std::vector<SSunsetProfile> newProfiles);
+    // index into the sorted profiles for the current local time, -1 if none applies
+    int                           currentProfile();
+
+    std::vector<SP<SOutput>>      findOutputs(std::string_view selector);
+    void                          resetOutputOverrides();
+    unsigned long long            kelvinFor(const SOutput& output) const;
+    float                         gammaFor(const SOutput& output) const;
+    bool                          identityFor(const SOutput& output) const;
+
+    // when the schedule fires next, if at all
+    std::optional<std::chrono::sys_seconds> nextTransition() const;
+
+    // the callback gets the epoll events, it may remove its own fd
+    void addPollFD(int fd, uint32_t events, std::function<void(uint32_t)> callback);
+    void updatePollFD(int fd, uint32_t events);
+    void removePollFD(int fd);
+
     struct {
-        std::condition_variable loopSignal;
-        std::mutex              loopMutex;
-        std::mutex              loopRequestMutex;
+        int                                                    epollFD = -1;
+        std::unordered_map<int, std::function<void(uint32_t)>> callbacks;
+
+        bool                                                   reloadPending = false; // done at the end of the loop iteration
+        bool                                                   coalescing    = false; // or once the coalesce window ends
 
-        bool                    shouldProcess = false;
-        bool                    isScheduled   = false;
+        std::vector<uint32_t>                                  hotplugPending; // outputs that came up since the hotplug timer was armed
     } m_sEventLoopInternals;
 
   private:
-    static void                 commitCTMs();
-    void                        reload();
+    void                        commitCTMs();
+    // animate = false jumps straight to the new values, for ramp steps which are small already
+    void                        reload(bool animate = true);
+    bool                        applyCurrentCTM();
+    Mat3x3                      matrixForOutput(const SOutput& output) const;
+    void                        onOutputReady(SP<SOutput> output);
+    // new outputs are sent together once the hotplug window ends, in a single commit
+    void                        queueHotplug(uint32_t id);
+    void                        flushHotplug();
+    // wayland connection, globals and picking the backend
+    bool                        connect();
+    void                        addNullOutput();
+    // false if there's no snapshot for this config
+    bool                        applySnapshot();
+    // the snapshot is written once commits stopped for a while, not for every transition frame
+    void                        armSnapshotTimer(std::chrono::nanoseconds delay);
+    void                        onSnapshotTimer();
+    void                        stepTransition();
+    void                        armTransitionTimer(bool arm);
     void                        schedule();
-    int                         currentProfile();
+    void                        handleScheduleTimer(bool boundary);
     void                        startEventLoop();
+    // the status page readers mmap, see include/hyprsunset/StatusPage.hpp
+    void                        publishStatus();
+
+    CProfileSchedule            m_schedule;
+    int                         m_iActiveProfile = -1;
+    std::vector<SOutputRule>    outputRules;
+    CTransition                 m_transition;
+    CSnapshot                   m_snapshot;
+    uint64_t                    m_iFingerprintSeed = 0;
+    uint64_t                    m_iFingerprint     = 0; // of the config files and fingerprintSeed, what the snapshot is written for
+    bool                        m_bSnapshotPending = false; // committed since the last save, the snapshot timer is armed
+
+    // the snapshot waits until this is a while ago
+    std::chrono::steady_clock::time_point m_lastCommit;
+
+    // set by schedule()
+    std::optional<std::chrono::sys_seconds>              m_nextTransition;
+    std::optional<std::chrono::system_clock::time_point> m_nextWake;
+    bool                                                 m_bRampStep = false; // the timer is armed for a step along a ramp, not a switch
 
-    std::vector<SSunsetProfile> profiles;
+    // the virtual clock while simulating, system_clock otherwise
+    std::optional<std::chrono::system_clock::time_point> m_simulatedNow;
+    std::chrono::system_clock::time_point                now() const;
 };
 
 inline std::unique_ptr<CHyprsunset> g_pHyprsunset;
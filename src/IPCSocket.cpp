@@ -1,251 +1,782 @@
 #include "IPCSocket.hpp"
+#include "ConfigManager.hpp"
 #include "Hyprsunset.hpp"
 #include "helpers/Log.hpp"
+#include "helpers/Stats.hpp"
+#include "helpers/Trace.hpp"
 
+#include <algorithm>
+#include <cctype>
 #include <cerrno>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <array>
+#include <charconv>
 #include <format>
+#include <iterator>
+#include <optional>
+#include <string_view>
+#include <type_traits>
 #include <netinet/in.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <sys/types.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include <pwd.h>
-#include <thread>
+#include <vector>
+
+// a client sending more than this without us being able to make sense of it gets dropped
+#define IPC_MAX_REQUEST_SIZE 4096
+// replies a client doesn't read pile up here, past this it gets dropped
+#define IPC_MAX_WRITE_BUFFER 65536
+// subscribers get a lot less slack, a stuck one mustn't hold on to every event
+#define IPC_MAX_SUBSCRIBER_BUFFER 16384
+
+CIPCSocket::CIPCSocket(CHyprsunset* hyprsunset) : m_pHyprsunset(hyprsunset) {
+    ;
+}
+
+CIPCSocket::~CIPCSocket() {
+    for (const auto& [FD, client] : m_mClients) {
+        close(FD);
+    }
+
+    if (m_iTimeoutFD >= 0)
+        close(m_iTimeoutFD);
+
+    if (m_iSocketFD >= 0)
+        close(m_iSocketFD);
+}
 
 void CIPCSocket::initialize() {
-    std::thread([&]() {
-        const auto SOCKET = socket(AF_UNIX, SOCK_STREAM, 0);
+    m_iSocketFD = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
 
-        if (SOCKET < 0) {
-            Debug::log(ERR, "Couldn't start the hyprsunset Socket. (1) IPC will not work.");
-            return;
-        }
+    if (m_iSocketFD < 0) {
+        Debug::log<ERR>("Couldn't start the hyprsunset Socket. (1) IPC will not work.");
+        return;
+    }
 
-        sockaddr_un       SERVERADDRESS = {.sun_family = AF_UNIX};
+    sockaddr_un       SERVERADDRESS = {.sun_family = AF_UNIX};
 
-        const auto        HISenv     = getenv("HYPRLAND_INSTANCE_SIGNATURE");
-        const auto        RUNTIMEdir = getenv("XDG_RUNTIME_DIR");
-        const std::string USERID     = std::to_string(getpwuid(getuid())->pw_uid);
+    const auto        HISenv     = getenv("HYPRLAND_INSTANCE_SIGNATURE");
+    const auto        RUNTIMEdir = getenv("XDG_RUNTIME_DIR");
+    const std::string USERID     = std::to_string(getpwuid(getuid())->pw_uid);
 
-        const auto        USERDIR = RUNTIMEdir ? RUNTIMEdir + std::string{"/hypr/"} : "/run/user/" + USERID + "/hypr/";
+    const auto        USERDIR = RUNTIMEdir ? RUNTIMEdir + std::string{"/hypr/"} : "/run/user/" + USERID + "/hypr/";
 
-        std::string       socketPath = HISenv ? USERDIR + std::string(HISenv) + "/.hyprsunset.sock" : USERDIR + ".hyprsunset.sock";
+    std::string       socketPath = HISenv ? USERDIR + std::string(HISenv) + "/.hyprsunset.sock" : USERDIR + ".hyprsunset.sock";
 
-        if (!HISenv)
-            mkdir(USERDIR.c_str(), S_IRWXU);
+    if (!HISenv)
+        mkdir(USERDIR.c_str(), S_IRWXU);
 
-        unlink(socketPath.c_str());
+    unlink(socketPath.c_str());
 
-        strcpy(SERVERADDRESS.sun_path, socketPath.c_str());
+    strcpy(SERVERADDRESS.sun_path, socketPath.c_str());
 
-        bind(SOCKET, (sockaddr*)&SERVERADDRESS, SUN_LEN(&SERVERADDRESS));
+    bind(m_iSocketFD, (sockaddr*)&SERVERADDRESS, SUN_LEN(&SERVERADDRESS));
 
-        // 10 max queued.
-        listen(SOCKET, 10);
+    listen(m_iSocketFD, g_pConfigManager->getIPCBacklog());
 
-        sockaddr_in clientAddress = {};
-        socklen_t   clientSize    = sizeof(clientAddress);
+    m_pHyprsunset->addPollFD(m_iSocketFD, EPOLLIN, [this](uint32_t) { onAccept(); });
 
-        char        readBuffer[1024] = {0};
+    m_timeout = g_pConfigManager->getIPCTimeout();
+    if (m_timeout.count() > 0) {
+        m_iTimeoutFD = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        m_pHyprsunset->addPollFD(m_iTimeoutFD, EPOLLIN, [this](uint32_t) { onTimeout(); });
+    }
 
-        Debug::log(LOG, "hyprsunset socket started at {} (fd: {})", socketPath, SOCKET);
-        while (1) {
-            const auto ACCEPTEDCONNECTION = accept(SOCKET, (sockaddr*)&clientAddress, &clientSize);
-            if (ACCEPTEDCONNECTION < 0) {
-                Debug::log(ERR, "Couldn't listen on the hyprsunset Socket. (3) IPC will not work.");
-                break;
-            } else {
-                do {
-                    Debug::log(LOG, "Accepted incoming socket connection request on fd {}", ACCEPTEDCONNECTION);
-                    std::lock_guard<std::mutex> lg(g_pHyprsunset->m_sEventLoopInternals.loopRequestMutex);
-
-                    auto                        messageSize              = read(ACCEPTEDCONNECTION, readBuffer, 1024);
-                    readBuffer[messageSize == 1024 ? 1023 : messageSize] = '\0';
-                    if (messageSize == 0)
-                        break;
-                    std::string request(readBuffer);
-
-                    m_szRequest     = request;
-                    m_bRequestReady = true;
-
-                    g_pHyprsunset->tick();
-                    while (!m_bReplyReady) { // wait for Hyprsunset to finish processing the request
-                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                    }
-                    write(ACCEPTEDCONNECTION, m_szReply.c_str(), m_szReply.length());
-                    m_bReplyReady = false;
-                    m_szReply     = "";
-
-                } while (1);
-                Debug::log(LOG, "Closing Accepted Connection");
-                close(ACCEPTEDCONNECTION);
-            }
+    Debug::log<LOG>("hyprsunset socket started at {} (fd: {})", socketPath, m_iSocketFD);
+}
+
+void CIPCSocket::onAccept() {
+    while (true) {
+        const auto ACCEPTEDCONNECTION = accept4(m_iSocketFD, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+
+        if (ACCEPTEDCONNECTION < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                Debug::log<ERR>("Couldn't accept on the hyprsunset Socket: {}", strerror(errno));
+            break;
         }
 
-        close(SOCKET);
-    }).detach();
+        Debug::log<LOG>("Accepted incoming socket connection request on fd {}", ACCEPTEDCONNECTION);
+
+        m_mClients.emplace(ACCEPTEDCONNECTION, SIPCClient{.fd = ACCEPTEDCONNECTION, .events = EPOLLIN, .lastActivity = std::chrono::steady_clock::now()});
+        m_pHyprsunset->addPollFD(ACCEPTEDCONNECTION, EPOLLIN, [this, ACCEPTEDCONNECTION](uint32_t events) { onClientEvent(ACCEPTEDCONNECTION, events); });
+    }
+
+    armTimeout();
 }
 
-bool CIPCSocket::mainThreadParseRequest() {
+void CIPCSocket::onClientEvent(int fd, uint32_t events) {
+    const auto IT = m_mClients.find(fd);
+    if (IT == m_mClients.end())
+        return;
 
-    if (!m_bRequestReady)
-        return false;
+    auto& client = IT->second;
 
-    std::string copy = m_szRequest;
+    if (events & EPOLLERR) {
+        closeClient(fd);
+        return;
+    }
 
-    if (copy == "")
-        return false;
+    if (events & (EPOLLIN | EPOLLHUP)) {
+        char readBuffer[1024];
+        bool eof = false;
 
-    // now we can work on the copy
+        while (true) {
+            const auto LEN = read(fd, readBuffer, sizeof(readBuffer));
 
-    Debug::log(LOG, "Received a request: {}", copy);
+            if (LEN > 0) {
+                client.readBuffer.append(readBuffer, LEN);
+                client.lastActivity = std::chrono::steady_clock::now();
+                processRequests(client, false);
 
-    // set default reply
-    m_szReply       = "ok";
-    m_bReplyReady   = true;
-    m_bRequestReady = false;
+                // only what's left after the complete lines counts, pipelining many short requests is fine
+                if (client.readBuffer.size() > IPC_MAX_REQUEST_SIZE) {
+                    Debug::log<WARN>("Client on fd {} sent an oversized request, dropping it", fd);
+                    closeClient(fd);
+                    return;
+                }
 
-    // config commands
-    if (copy.find("gamma") == 0) {
-        int spaceSeparator = copy.find_first_of(' ');
-        if (spaceSeparator == -1) {
-            m_szReply = std::to_string(g_pHyprsunset->GAMMA * 100);
-            return false;
-        }
+                continue;
+            }
 
-        std::string args     = copy.substr(spaceSeparator + 1);
-        float       gamma    = g_pHyprsunset->GAMMA * 100;
-        float       maxGamma = g_pHyprsunset->MAX_GAMMA * 100;
-        try {
-            if (args[0] == '+' || args[0] == '-') {
-                if (args[0] == '-')
-                    gamma -= std::stof(args.substr(1));
-                else
-                    gamma += std::stof(args.substr(1));
-                gamma = std::clamp(gamma, 0.0f, maxGamma);
-            } else
-                gamma = std::stof(args);
-        } catch (std::exception& e) {
-            m_szReply = "Invalid gamma value (should be in range 0-" + std::to_string(maxGamma) + "%)";
-            return false;
-        }
+            if (LEN < 0 && errno == EINTR)
+                continue;
 
-        if (gamma < 0 || gamma > maxGamma) {
-            m_szReply = "Invalid gamma value (should be in range 0-" + std::to_string(maxGamma) + "%)";
-            return false;
+            eof = LEN == 0 || (errno != EAGAIN && errno != EWOULDBLOCK);
+            break;
         }
 
-        g_pHyprsunset->GAMMA = gamma / 100;
-        return true;
+        // hyprctl doesn't terminate its request or shut down its end, it just waits for the reply. so once nothing more is queued
+        // an unterminated rest is a request of its own, unless this client terminates its requests and the rest is still on its way
+        if (eof || !client.framed)
+            processRequests(client, true);
+
+        // let the reply go out before closing if the client already shut down its end
+        if (eof)
+            client.closing = true;
     }
 
-    if (copy.find("temperature") == 0) {
-        int spaceSeparator = copy.find_first_of(' ');
-        if (spaceSeparator == -1) {
-            m_szReply = std::to_string(g_pHyprsunset->KELVIN);
-            return false;
-        }
+    if (!flushClient(client))
+        closeClient(fd);
+}
 
-        std::string        args   = copy.substr(spaceSeparator + 1);
-        unsigned long long kelvin = g_pHyprsunset->KELVIN;
-        try {
-            if (args[0] == '+' || args[0] == '-') {
-                if (args[0] == '-')
-                    kelvin -= std::stoull(args.substr(1));
-                else
-                    kelvin += std::stoull(args.substr(1));
-                kelvin = std::clamp(kelvin, 1000ull, 20000ull);
-            } else
-                kelvin = std::stoull(args);
-        } catch (std::exception& e) {
-            m_szReply = "Invalid temperature (should be an integer in range 1000-20000)";
-            return false;
+void CIPCSocket::processRequests(SIPCClient& client, bool whole) {
+    std::string_view pending = client.readBuffer;
+
+    while (!pending.empty()) {
+        // requests are newline separated, clients that don't terminate theirs send just one
+        const auto NEWLINE = pending.find('\n');
+        if (NEWLINE == std::string_view::npos && !whole)
+            break;
+
+        if (NEWLINE != std::string_view::npos)
+            client.framed = true;
+
+        const auto REQUEST = pending.substr(0, NEWLINE);
+        pending            = NEWLINE == std::string_view::npos ? std::string_view{} : pending.substr(NEWLINE + 1);
+
+        if (REQUEST.empty())
+            continue;
+
+        const auto RESULT = mainThreadParseRequest(REQUEST, client.writeBuffer);
+
+        if (RESULT == IPC_RESULT_CHANGED) {
+            Stats::requestReceived(client.lastActivity);
+            m_pHyprsunset->scheduleReload();
         }
-        if (kelvin < 1000 || kelvin > 20000) {
-            m_szReply = "Invalid temperature (should be an integer in range 1000-20000)";
-            return false;
+        else if (RESULT == IPC_RESULT_SUBSCRIBE && !client.subscribed) {
+            client.subscribed = true;
+            m_iSubscribers++;
         }
 
-        g_pHyprsunset->KELVIN   = kelvin;
-        g_pHyprsunset->identity = false;
-        return true;
+        if (NEWLINE != std::string_view::npos)
+            client.writeBuffer += '\n';
     }
 
-    if (copy.find("identity") == 0) {
-        int spaceSeparator = copy.find_first_of(' ');
-        if (spaceSeparator == -1) {
-            g_pHyprsunset->identity = true;
-            return true;
-        }
+    client.readBuffer.erase(0, client.readBuffer.size() - pending.size());
+}
 
-        std::string args = copy.substr(spaceSeparator + 1);
-        if (args == "get") {
-            m_szReply = g_pHyprsunset->identity ? "true" : "false";
-            return false;
-        } else if (args == "true") {
-            g_pHyprsunset->identity = true;
-            return true;
-        } else if (args == "false") {
-            g_pHyprsunset->identity = false;
-            return true;
-        } else {
-            m_szReply = "Invalid identity value (should be true or false)";
+bool CIPCSocket::flushClient(SIPCClient& client) {
+    while (!client.writeBuffer.empty()) {
+        const auto LEN = send(client.fd, client.writeBuffer.data(), client.writeBuffer.size(), MSG_NOSIGNAL);
+
+        if (LEN < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
             return false;
         }
+
+        client.writeBuffer.erase(0, LEN);
     }
 
-    if (copy.find("reset") == 0) {
-        int spaceSeparator = copy.find_first_of(' ');
+    if (client.writeBuffer.size() > IPC_MAX_WRITE_BUFFER) {
+        Debug::log<WARN>("Client on fd {} isn't reading its replies, dropping it", client.fd);
+        return false;
+    }
 
-        // Reset whole profile
-        if (spaceSeparator == -1) {
-            g_pHyprsunset->loadCurrentProfile();
-            return true;
-        }
+    if (client.closing && client.writeBuffer.empty())
+        return false;
 
-        if (auto profileOpt = g_pHyprsunset->getCurrentProfile()) {
-            auto        profile = profileOpt.value();
-            std::string args    = copy.substr(spaceSeparator + 1);
-
-            if (args == "temperature") {
-                g_pHyprsunset->KELVIN = profile.temperature;
-                return true;
-            } else if (args == "gamma") {
-                g_pHyprsunset->GAMMA = profile.gamma;
-                return true;
-            } else if (args == "identity") {
-                g_pHyprsunset->identity = profile.identity;
-                return true;
-            } else {
-                m_szReply = "Invalid reset value (should be either temperature, gamma or identity)";
-                return false;
-            }
+    const uint32_t EVENTS = (client.closing ? 0 : EPOLLIN) | (client.writeBuffer.empty() ? 0 : EPOLLOUT);
+    if (EVENTS != client.events) {
+        client.events = EVENTS;
+        m_pHyprsunset->updatePollFD(client.fd, EVENTS);
+    }
+
+    return true;
+}
+
+void CIPCSocket::closeClient(int fd) {
+    Debug::log<LOG>("Closing Accepted Connection");
+
+    if (const auto IT = m_mClients.find(fd); IT != m_mClients.end() && IT->second.subscribed)
+        m_iSubscribers--;
+
+    m_pHyprsunset->removePollFD(fd);
+    m_mClients.erase(fd);
+    close(fd);
+}
+
+void CIPCSocket::broadcast(const std::string& event) {
+    std::vector<int> dropped;
+
+    for (auto& [FD, client] : m_mClients) {
+        if (!client.subscribed)
+            continue;
+
+        // never wait on a subscriber, if it can't keep up it's gone
+        if (client.writeBuffer.size() + event.size() + 1 > IPC_MAX_SUBSCRIBER_BUFFER) {
+            Debug::log<WARN>("Subscriber on fd {} isn't keeping up, dropping it", FD);
+            dropped.emplace_back(FD);
+            continue;
         }
-        m_szReply = "No profile is currently loaded";
+
+        client.writeBuffer += event;
+        client.writeBuffer += '\n';
+
+        if (!flushClient(client))
+            dropped.emplace_back(FD);
+    }
+
+    for (const auto FD : dropped) {
+        closeClient(FD);
+    }
+}
+
+void CIPCSocket::armTimeout() {
+    if (m_iTimeoutFD < 0 || m_bTimeoutArmed || m_mClients.empty())
+        return;
+
+    auto oldest = std::chrono::steady_clock::time_point::max();
+    for (const auto& [FD, client] : m_mClients) {
+        if (!client.subscribed)
+            oldest = std::min(oldest, client.lastActivity);
+    }
+
+    if (oldest == std::chrono::steady_clock::time_point::max())
+        return;
+
+    // only the oldest client matters, others that were active since then get a fresh timer once this fires
+    const auto REMAINING = std::max(std::chrono::duration_cast<std::chrono::nanoseconds>(oldest + m_timeout - std::chrono::steady_clock::now()), std::chrono::nanoseconds{1});
+
+    itimerspec ts = {.it_value = {.tv_sec = REMAINING.count() / 1000000000L, .tv_nsec = REMAINING.count() % 1000000000L}};
+    timerfd_settime(m_iTimeoutFD, 0, &ts, nullptr);
+
+    m_bTimeoutArmed = true;
+}
+
+void CIPCSocket::onTimeout() {
+    uint64_t expirations = 0;
+    read(m_iTimeoutFD, &expirations, sizeof(expirations));
+
+    m_bTimeoutArmed = false;
+
+    const auto       NOW = std::chrono::steady_clock::now();
+    std::vector<int> expired;
+
+    for (const auto& [FD, client] : m_mClients) {
+        if (!client.subscribed && NOW - client.lastActivity >= m_timeout)
+            expired.emplace_back(FD);
+    }
+
+    for (const auto FD : expired) {
+        Debug::log<LOG>("Connection on fd {} was idle for too long", FD);
+        closeClient(FD);
+    }
+
+    armTimeout();
+}
+
+// "VALUE [SELECTOR]" or just "SELECTOR", a value is a number or a keyword, anything after it selects outputs
+static std::pair<std::string_view, std::string_view> splitSelector(std::string_view args) {
+    const auto SPACE = args.find(' ');
+    const auto VALUE = args.substr(0, SPACE);
+
+    const bool ISVALUE = !VALUE.empty() && (std::isdigit(VALUE[0]) || VALUE[0] == '+' || VALUE[0] == '-' || VALUE[0] == '.' || VALUE == "get" || VALUE == "true" || VALUE == "false");
+
+    if (!ISVALUE)
+        return {"", args};
+
+    return {VALUE, SPACE == std::string_view::npos ? "" : args.substr(SPACE + 1)};
+}
+
+template <typename T>
+static bool parseNumber(std::string_view str, T& out) {
+    const auto [PTR, EC] = std::from_chars(str.data(), str.data() + str.size(), out);
+    if (EC != std::errc{} || PTR != str.data() + str.size())
         return false;
+
+    // from_chars takes "nan" and "inf", which would slip through every range check after this
+    if constexpr (std::is_floating_point_v<T>)
+        return std::isfinite(out);
+
+    return true;
+}
+
+template <typename... Args>
+static eIPCResult replyError(std::string& reply, std::format_string<Args...> fmt, Args&&... args) {
+    std::format_to(std::back_inserter(reply), fmt, std::forward<Args>(args)...);
+    return IPC_RESULT_ERROR;
+}
+
+static void appendJSONString(std::string& reply, std::string_view str) {
+    reply += '"';
+    for (const char c : str) {
+        if (c == '"' || c == '\\')
+            reply += '\\';
+
+        if ((unsigned char)c < 0x20)
+            std::format_to(std::back_inserter(reply), "\\u{:04x}", (int)c);
+        else
+            reply += c;
     }
+    reply += '"';
+}
+
+static void appendStateJSON(CHyprsunset& hyprsunset, std::string& reply) {
+    const auto INSERTER = std::back_inserter(reply);
+
+    std::format_to(INSERTER, R"({{"temperature":{},"gamma":{},"identity":{},"profile":)", hyprsunset.KELVIN, hyprsunset.GAMMA * 100, hyprsunset.identity);
+
+    if (const auto PROFILE = hyprsunset.getCurrentProfile(); PROFILE)
+        std::format_to(INSERTER, R"({{"time":"{}","temperature":{},"gamma":{},"identity":{}}})", PROFILE->timeString(), PROFILE->temperature, PROFILE->gamma * 100,
+                       PROFILE->identity);
+    else
+        reply += "null";
+
+    reply += R"(,"next_transition":)";
+    if (const auto NEXT = hyprsunset.nextTransition(); NEXT)
+        std::format_to(INSERTER, "{}", NEXT->time_since_epoch().count());
+    else
+        reply += "null";
 
-    if (copy.find("profile") == 0) {
-        if (auto profileOpt = g_pHyprsunset->getCurrentProfile()) {
-            auto  profile = profileOpt.value();
+    reply += R"(,"outputs":[)";
+    bool first = true;
+    for (const auto& o : hyprsunset.state.outputs | std::views::values) {
+        if (!o->ready)
+            continue;
+
+        if (!first)
+            reply += ',';
+        first = false;
+
+        reply += R"({"name":)";
+        appendJSONString(reply, o->name);
+        std::format_to(INSERTER, R"(,"temperature":{},"gamma":{},"identity":{}}})", hyprsunset.kelvinFor(*o), hyprsunset.gammaFor(*o) * 100, hyprsunset.identityFor(*o));
+    }
+    reply += "]}";
+}
+
+static eIPCResult commandGamma(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    if (args.empty()) {
+        std::format_to(std::back_inserter(reply), "{}", hyprsunset.GAMMA * 100);
+        return IPC_RESULT_QUERY;
+    }
 
-            int   hrs   = profile.time.hour.count();
-            int   mins  = profile.time.minute.count();
-            auto  temp  = profile.temperature;
-            float gamma = profile.gamma;
-            bool  ident = profile.identity;
+    const auto [VALUE, SELECTOR] = splitSelector(args);
 
-            m_szReply = std::format("Time: {:0>2}:{:0>2}\nTemperature: {}\nGamma: {}\nIdentity: {}", hrs, mins, temp, gamma, ident);
-            return true;
+    auto outputs = hyprsunset.findOutputs(SELECTOR);
+    if (!SELECTOR.empty() && outputs.empty())
+        return replyError(reply, "No output matches {}", SELECTOR);
+
+    float       gamma    = (outputs.empty() ? hyprsunset.GAMMA : hyprsunset.gammaFor(*outputs.front())) * 100;
+    const float MAXGAMMA = hyprsunset.MAX_GAMMA * 100;
+
+    if (VALUE.empty()) {
+        std::format_to(std::back_inserter(reply), "{}", gamma);
+        return IPC_RESULT_QUERY;
+    }
+
+    const bool RELATIVE = VALUE[0] == '+' || VALUE[0] == '-';
+    float      parsed   = 0;
+
+    if (!parseNumber(RELATIVE ? VALUE.substr(1) : VALUE, parsed))
+        return replyError(reply, "Invalid gamma value (should be in range 0-{}%)", MAXGAMMA);
+
+    if (RELATIVE)
+        gamma = std::clamp(VALUE[0] == '-' ? gamma - parsed : gamma + parsed, 0.F, MAXGAMMA);
+    else
+        gamma = parsed;
+
+    if (!(gamma >= 0 && gamma <= MAXGAMMA))
+        return replyError(reply, "Invalid gamma value (should be in range 0-{}%)", MAXGAMMA);
+
+    if (outputs.empty())
+        hyprsunset.GAMMA = gamma / 100;
+
+    for (auto& o : outputs) {
+        o->overrides.gamma = gamma / 100;
+    }
+
+    return IPC_RESULT_CHANGED;
+}
+
+static eIPCResult commandTemperature(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    if (args.empty()) {
+        std::format_to(std::back_inserter(reply), "{}", hyprsunset.KELVIN);
+        return IPC_RESULT_QUERY;
+    }
+
+    const auto [VALUE, SELECTOR] = splitSelector(args);
+
+    auto outputs = hyprsunset.findOutputs(SELECTOR);
+    if (!SELECTOR.empty() && outputs.empty())
+        return replyError(reply, "No output matches {}", SELECTOR);
+
+    long long kelvin = outputs.empty() ? hyprsunset.KELVIN : hyprsunset.kelvinFor(*outputs.front());
+
+    if (VALUE.empty()) {
+        std::format_to(std::back_inserter(reply), "{}", kelvin);
+        return IPC_RESULT_QUERY;
+    }
+
+    const bool RELATIVE = VALUE[0] == '+' || VALUE[0] == '-';
+    long long  parsed   = 0;
+
+    // nothing past the range is meaningful as an offset either, and it keeps kelvin +- parsed from overflowing
+    if (!parseNumber(RELATIVE ? VALUE.substr(1) : VALUE, parsed) || parsed < 0 || parsed > 20000)
+        return replyError(reply, "Invalid temperature (should be an integer in range 1000-20000)");
+
+    if (RELATIVE)
+        kelvin = std::clamp(VALUE[0] == '-' ? kelvin - parsed : kelvin + parsed, 1000LL, 20000LL);
+    else
+        kelvin = parsed;
+
+    if (kelvin < 1000 || kelvin > 20000)
+        return replyError(reply, "Invalid temperature (should be an integer in range 1000-20000)");
+
+    if (outputs.empty()) {
+        hyprsunset.KELVIN   = kelvin;
+        hyprsunset.identity = false;
+    }
+
+    for (auto& o : outputs) {
+        o->overrides.temperature = kelvin;
+        o->overrides.identity    = false;
+    }
+
+    return IPC_RESULT_CHANGED;
+}
+
+static eIPCResult commandIdentity(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    if (args.empty()) {
+        hyprsunset.identity = true;
+        return IPC_RESULT_CHANGED;
+    }
+
+    const auto [VALUE, SELECTOR] = splitSelector(args);
+
+    auto outputs = hyprsunset.findOutputs(SELECTOR);
+    if (!SELECTOR.empty() && outputs.empty())
+        return replyError(reply, "No output matches {}", SELECTOR);
+
+    if (VALUE == "get") {
+        reply += (outputs.empty() ? hyprsunset.identity : hyprsunset.identityFor(*outputs.front())) ? "true" : "false";
+        return IPC_RESULT_QUERY;
+    }
+
+    if (VALUE != "true" && VALUE != "false")
+        return replyError(reply, "Invalid identity value (should be true or false)");
+
+    if (outputs.empty())
+        hyprsunset.identity = VALUE == "true";
+
+    for (auto& o : outputs) {
+        o->overrides.identity = VALUE == "true";
+    }
+
+    return IPC_RESULT_CHANGED;
+}
+
+// set KEY=VALUE..., validated as a whole and applied with a single reload or not at all
+static eIPCResult commandSet(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    std::optional<unsigned long long> kelvin;
+    std::optional<float>              gamma;
+    std::optional<bool>               ident;
+    std::string_view                  selector;
+
+    while (!args.empty()) {
+        if (args[0] == ' ') {
+            args.remove_prefix(1);
+            continue;
+        }
+
+        const auto EQUALS = args.find('=');
+        if (EQUALS == std::string_view::npos)
+            return replyError(reply, "Invalid transaction: expected key=value, got {}", args.substr(0, args.find(' ')));
+
+        const auto KEY = args.substr(0, EQUALS);
+
+        // descriptions have spaces, the selector takes the rest of the line
+        if (KEY == "output") {
+            selector = args.substr(EQUALS + 1);
+            break;
+        }
+
+        const auto SPACE = args.find(' ', EQUALS);
+        const auto VALUE = args.substr(EQUALS + 1, SPACE == std::string_view::npos ? std::string_view::npos : SPACE - EQUALS - 1);
+        args             = SPACE == std::string_view::npos ? std::string_view{} : args.substr(SPACE + 1);
+
+        if (KEY == "temperature" && !kelvin) {
+            unsigned long long parsed = 0;
+            if (!parseNumber(VALUE, parsed) || parsed < 1000 || parsed > 20000)
+                return replyError(reply, "Invalid transaction: temperature should be an integer in range 1000-20000");
+            kelvin = parsed;
+        } else if (KEY == "gamma" && !gamma) {
+            float parsed = 0;
+            if (!parseNumber(VALUE, parsed) || !(parsed >= 0 && parsed <= hyprsunset.MAX_GAMMA * 100))
+                return replyError(reply, "Invalid transaction: gamma should be in range 0-{}%", hyprsunset.MAX_GAMMA * 100);
+            gamma = parsed;
+        } else if (KEY == "identity" && !ident) {
+            if (VALUE != "true" && VALUE != "false")
+                return replyError(reply, "Invalid transaction: identity should be true or false");
+            ident = VALUE == "true";
+        } else
+            return replyError(reply, "Invalid transaction: unknown or repeated key {}", KEY);
+    }
+
+    if (!kelvin && !gamma && !ident)
+        return replyError(reply, "Invalid transaction: nothing to set");
+
+    auto outputs = hyprsunset.findOutputs(selector);
+    if (!selector.empty() && outputs.empty())
+        return replyError(reply, "No output matches {}", selector);
+
+    // setting a temperature turns identity off unless the transaction says otherwise, same as the temperature command
+    if (kelvin && !ident)
+        ident = false;
+
+    if (outputs.empty()) {
+        if (kelvin)
+            hyprsunset.KELVIN = *kelvin;
+        if (gamma)
+            hyprsunset.GAMMA = *gamma / 100;
+        if (ident)
+            hyprsunset.identity = *ident;
+    }
+
+    for (auto& o : outputs) {
+        if (kelvin)
+            o->overrides.temperature = *kelvin;
+        if (gamma)
+            o->overrides.gamma = *gamma / 100;
+        if (ident)
+            o->overrides.identity = *ident;
+    }
+
+    return IPC_RESULT_CHANGED;
+}
+
+static eIPCResult commandReset(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    // Reset whole profile, including output overrides set over IPC
+    if (args.empty()) {
+        hyprsunset.loadCurrentProfile();
+        return IPC_RESULT_CHANGED;
+    }
+
+    const auto PROFILE = hyprsunset.getCurrentProfile();
+    if (!PROFILE)
+        return replyError(reply, "No profile is currently loaded");
+
+    if (args == "temperature")
+        hyprsunset.KELVIN = PROFILE->temperature;
+    else if (args == "gamma")
+        hyprsunset.GAMMA = PROFILE->gamma;
+    else if (args == "identity")
+        hyprsunset.identity = PROFILE->identity;
+    else
+        return replyError(reply, "Invalid reset value (should be either temperature, gamma or identity)");
+
+    return IPC_RESULT_CHANGED;
+}
+
+static eIPCResult commandProfile(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    const auto PROFILE = hyprsunset.getCurrentProfile();
+    if (!PROFILE)
+        return replyError(reply, "No profile is currently loaded");
+
+    std::format_to(std::back_inserter(reply), "Time: {}\nTemperature: {}\nGamma: {}\nIdentity: {}", PROFILE->timeString(), PROFILE->temperature, PROFILE->gamma,
+                   PROFILE->identity);
+    return IPC_RESULT_QUERY;
+}
+
+static eIPCResult commandJSON(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    appendStateJSON(hyprsunset, reply);
+    return IPC_RESULT_QUERY;
+}
+
+static eIPCResult commandSubscribe(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    reply += "ok";
+    return IPC_RESULT_SUBSCRIBE;
+}
+
+// re-applying is left to reloadConfig, it knows what actually changed
+static eIPCResult commandReload(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    if (!hyprsunset.reloadConfig())
+        return replyError(reply, "Config has errors, keeping the running config");
+
+    reply += "ok";
+    return IPC_RESULT_QUERY;
+}
+
+static eIPCResult commandStats(CHyprsunset& hyprsunset, std::string_view args, std::string& reply);
+static void       appendStatsJSON(CHyprsunset& hyprsunset, std::string& reply);
+
+struct SIPCCommand {
+    std::string_view name;
+    eIPCResult (*handler)(CHyprsunset& hyprsunset, std::string_view args, std::string& reply);
+    // what -j replies with instead of the state, if set
+    void (*json)(CHyprsunset& hyprsunset, std::string& reply) = nullptr;
+};
+
+static constexpr std::array<SIPCCommand, 10> COMMANDS = {{
+    {"temperature", commandTemperature},
+    {"gamma", commandGamma},
+    {"identity", commandIdentity},
+    {"set", commandSet},
+    {"reset", commandReset},
+    {"profile", commandProfile},
+    {"json", commandJSON},
+    {"subscribe", commandSubscribe},
+    {"reload", commandReload},
+    {"stats", commandStats, appendStatsJSON},
+}};
+
+// per entry in COMMANDS, the last one counts requests that didn't match any
+static std::array<uint64_t, COMMANDS.size() + 1> requestCounts;
+
+static void appendHistogramJSON(std::string& reply, const Stats::SHistogram& histogram) {
+    const auto INSERTER = std::back_inserter(reply);
+
+    std::format_to(INSERTER, R"({{"count":{},"sum_us":{},"min_us":{},"max_us":{},"p50_us":{},"p99_us":{},"buckets":[)", histogram.count, histogram.sum,
+                   histogram.count ? histogram.min : 0, histogram.max, histogram.quantile(0.5), histogram.quantile(0.99));
+
+    for (size_t i = 0; i < histogram.buckets.size(); ++i) {
+        std::format_to(INSERTER, "{}{}", i ? "," : "", histogram.buckets[i]);
+    }
+
+    reply += "]}";
+}
+
+static void appendStatsJSON(CHyprsunset& hyprsunset, std::string& reply) {
+    const auto INSERTER = std::back_inserter(reply);
+
+    std::format_to(INSERTER, R"({{"uptime":{},"requests":{{)", std::chrono::duration_cast<std::chrono::seconds>(Stats::clock::now() - Stats::start).count());
+    for (size_t i = 0; i < COMMANDS.size(); ++i) {
+        std::format_to(INSERTER, R"("{}":{},)", COMMANDS[i].name, requestCounts[i]);
+    }
+    std::format_to(INSERTER, R"("invalid":{}}})", requestCounts.back());
+
+    for (size_t i = 0; i < STAT_COUNTER_COUNT; ++i) {
+        std::format_to(INSERTER, R"(,"{}":{})", Stats::counterName((eStatCounter)i), Stats::counters[i]);
+    }
+    std::format_to(INSERTER, R"(,"log_dropped":{},"backend":"{}")", Debug::dropped(), hyprsunset.state.backend ? hyprsunset.state.backend->name() : "none");
+
+    for (size_t i = 0; i < STAT_HISTOGRAM_COUNT; ++i) {
+        std::format_to(INSERTER, R"(,"{}":)", Stats::histogramName((eStatHistogram)i));
+        appendHistogramJSON(reply, Stats::histograms[i]);
+    }
+
+    reply += '}';
+}
+
+static eIPCResult commandStats(CHyprsunset& hyprsunset, std::string_view args, std::string& reply) {
+    const auto INSERTER = std::back_inserter(reply);
+
+    std::format_to(INSERTER, "uptime: {}s\nrequests:", std::chrono::duration_cast<std::chrono::seconds>(Stats::clock::now() - Stats::start).count());
+    for (size_t i = 0; i < COMMANDS.size(); ++i) {
+        std::format_to(INSERTER, " {}={}", COMMANDS[i].name, requestCounts[i]);
+    }
+    std::format_to(INSERTER, " invalid={}", requestCounts.back());
+
+    for (size_t i = 0; i < STAT_COUNTER_COUNT; ++i) {
+        std::format_to(INSERTER, "\n{}: {}", Stats::counterName((eStatCounter)i), Stats::counters[i]);
+    }
+    std::format_to(INSERTER, "\nlog_dropped: {}\nbackend: {}", Debug::dropped(), hyprsunset.state.backend ? hyprsunset.state.backend->name() : "none");
+
+    // quantiles are bucket bounds, good to a factor of two
+    for (size_t i = 0; i < STAT_HISTOGRAM_COUNT; ++i) {
+        const auto& HISTOGRAM = Stats::histograms[i];
+        std::format_to(INSERTER, "\n{}: count={} min={}us avg={}us p50<={}us p99<={}us max={}us", Stats::histogramName((eStatHistogram)i), HISTOGRAM.count,
+                       HISTOGRAM.count ? HISTOGRAM.min : 0, HISTOGRAM.count ? HISTOGRAM.sum / HISTOGRAM.count : 0, HISTOGRAM.quantile(0.5), HISTOGRAM.quantile(0.99), HISTOGRAM.max);
+    }
+
+    return IPC_RESULT_QUERY;
+}
+
+eIPCResult CIPCSocket::mainThreadParseRequest(std::string_view request, std::string& reply) {
+    TRACE_SCOPE("ipc request");
+
+    Debug::log<LOG>("Received a request: {}", request);
+
+    // -j: the reply is the whole state as json (or an error object) instead of text
+    bool json = false;
+    if (request == "-j" || request.starts_with("-j ")) {
+        json = true;
+        request.remove_prefix(std::min<size_t>(3, request.size()));
+    }
+
+    if (json && request.empty())
+        request = "json";
+
+    const auto SPACE   = request.find(' ');
+    const auto NAME    = request.substr(0, SPACE);
+    const auto ARGS    = SPACE == std::string_view::npos ? std::string_view{} : request.substr(SPACE + 1);
+    const auto COMMAND = std::find_if(COMMANDS.begin(), COMMANDS.end(), [NAME](const auto& c) { return c.name == NAME; });
+
+    requestCounts[std::distance(COMMANDS.begin(), COMMAND)]++;
+
+    const auto START  = reply.size();
+    const auto RESULT = COMMAND == COMMANDS.end() ? replyError(reply, "invalid command") : COMMAND->handler(*m_pHyprsunset, ARGS, reply);
+
+    if (RESULT == IPC_RESULT_CHANGED && reply.size() == START)
+        reply += "ok";
+
+    if (json) {
+        if (RESULT == IPC_RESULT_ERROR) {
+            // reuse the text error, just wrapped
+            const std::string MESSAGE{reply.data() + START, reply.size() - START};
+            reply.resize(START);
+            reply += R"({"error":)";
+            appendJSONString(reply, MESSAGE);
+            reply += '}';
+        } else {
+            reply.resize(START);
+            if (COMMAND->json)
+                COMMAND->json(*m_pHyprsunset, reply);
+            else
+                appendStateJSON(*m_pHyprsunset, reply);
         }
-        m_szReply = "No profile is currently loaded";
-        return false;
     }
 
-    m_szReply = "invalid command";
-    return false;
+    return RESULT;
 }
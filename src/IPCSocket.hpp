@@ -1,22 +1,72 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <format>
 #include <string>
+#include <string_view>
 #include <memory>
-#include <mutex>
+#include <unordered_map>
+
+class CHyprsunset;
+
+enum eIPCResult : uint8_t {
+    IPC_RESULT_QUERY = 0, // reply holds the answer, nothing changed
+    IPC_RESULT_CHANGED,   // state changed, needs a reload
+    IPC_RESULT_ERROR,     // reply holds the error, nothing changed
+    IPC_RESULT_SUBSCRIBE, // the client wants state change events pushed from now on
+};
+
+struct SIPCClient {
+    int                                   fd     = -1;
+    uint32_t                              events = 0; // what we're currently polling for
+    std::chrono::steady_clock::time_point lastActivity;
+
+    std::string                           readBuffer; // the start of a request whose newline hasn't arrived yet
+    std::string                           writeBuffer;
+
+    bool                                  closing    = false; // peer is done sending, close once writeBuffer is flushed
+    bool                                  subscribed = false; // gets events, exempt from the idle timeout
+    bool                                  framed     = false; // sent a newline terminated request, so a rest without one is still on its way
+};
 
 class CIPCSocket {
   public:
+    CIPCSocket(CHyprsunset* hyprsunset);
+    ~CIPCSocket();
+
     void initialize();
 
-    bool mainThreadParseRequest();
+    // appends the reply for request
+    eIPCResult mainThreadParseRequest(std::string_view request, std::string& reply);
+
+    // pushes "EVENT>>DATA" to subscribers, nothing is formatted if there are none
+    template <typename... Args>
+    void notify(std::format_string<Args...> fmt, Args&&... args) {
+        if (m_iSubscribers <= 0)
+            return;
+
+        broadcast(std::format(fmt, std::forward<Args>(args)...));
+    }
 
   private:
-    std::mutex  m_mtRequestMutex;
-    std::string m_szRequest = "";
-    std::string m_szReply   = "";
+    void                                onAccept();
+    void                                onClientEvent(int fd, uint32_t events);
+    // runs the complete lines in readBuffer, whole runs an unterminated rest as a request too
+    void                                processRequests(SIPCClient& client, bool whole);
+    bool                                flushClient(SIPCClient& client);
+    void                                closeClient(int fd);
+    void                                armTimeout();
+    void                                onTimeout();
+    void                                broadcast(const std::string& event);
 
-    bool        m_bRequestReady = false;
-    bool        m_bReplyReady   = false;
+    CHyprsunset*                        m_pHyprsunset   = nullptr;
+    int                                 m_iSocketFD     = -1;
+    int                                 m_iTimeoutFD    = -1;
+    bool                                m_bTimeoutArmed = false;
+    std::chrono::milliseconds           m_timeout{0};
+    std::unordered_map<int, SIPCClient> m_mClients;
+    int                                 m_iSubscribers = 0;
 };
 
 inline std::unique_ptr<CIPCSocket> g_pIPCSocket;
@@ -0,0 +1,257 @@
+#include "ProfileSchedule.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <format>
+
+// how far ahead the index reaches, a week covers every weekday pattern
+#define SCHEDULE_INDEX_DAYS 7
+// how far to look for a switch before today / after the index, only a date range can leave a gap this long
+#define SCHEDULE_SEARCH_DAYS 366
+// seconds, the shortest sleep between two steps of a ramp
+#define RAMP_MIN_INTERVAL 1
+// for inverting a curve, precise to well under a millisecond on a day long ramp
+#define RAMP_BISECT_ITERATIONS 32
+
+bool SDateRange::contains(std::chrono::month_day day) const {
+    if (from <= to)
+        return day >= from && day <= to;
+
+    return day >= from || day <= to;
+}
+
+bool SSunsetProfile::appliesOn(std::chrono::year_month_day date) const {
+    const std::chrono::weekday WEEKDAY{std::chrono::sys_days{date}};
+
+    if (!(days & (1 << WEEKDAY.c_encoding())))
+        return false;
+
+    return !dates || dates->contains(std::chrono::month_day{date.month(), date.day()});
+}
+
+std::string SSunsetProfile::timeString() const {
+    if (anchor == SOLAR_EVENT_NONE)
+        return std::format("{:0>2}:{:0>2}", time.hour.count(), time.minute.count());
+
+    std::string result{Solar::eventName(anchor)};
+
+    if (offset.count() == 0)
+        return result;
+
+    const auto ABS = std::chrono::abs(offset);
+    result += offset.count() < 0 ? '-' : '+';
+
+    if (ABS >= std::chrono::hours{1})
+        result += std::format("{}h", std::chrono::floor<std::chrono::hours>(ABS).count());
+    if (ABS % std::chrono::hours{1} != std::chrono::minutes{0})
+        result += std::format("{}m", (ABS % std::chrono::hours{1}).count());
+
+    return result;
+}
+
+void CProfileSchedule::setProfiles(std::vector<SSunsetProfile> profiles) {
+    m_vProfiles = std::move(profiles);
+
+    std::stable_sort(m_vProfiles.begin(), m_vProfiles.end(), [](const auto& a, const auto& b) {
+        if (a.time.hour < b.time.hour)
+            return true;
+        else if (a.time.hour > b.time.hour)
+            return false;
+        else
+            return a.time.minute < b.time.minute;
+    });
+
+    m_bAnchored = std::ranges::any_of(m_vProfiles, [](const auto& p) { return p.anchor != SOLAR_EVENT_NONE; });
+    m_bValid    = false;
+}
+
+void CProfileSchedule::setLocation(std::optional<SLocation> location) {
+    m_location = location;
+    m_bValid   = false;
+}
+
+const std::optional<SLocation>& CProfileSchedule::location() const {
+    return m_location;
+}
+
+const std::vector<SSunsetProfile>& CProfileSchedule::profiles() const {
+    return m_vProfiles;
+}
+
+void CProfileSchedule::setZone(const std::chrono::time_zone* zone) {
+    m_pZone  = zone;
+    m_bValid = false;
+}
+
+const std::chrono::time_zone* CProfileSchedule::zone() const {
+    return m_pZone ? m_pZone : std::chrono::current_zone();
+}
+
+void CProfileSchedule::invalidate() {
+    m_bValid = false;
+}
+
+int CProfileSchedule::current(std::chrono::system_clock::time_point now) {
+    ensureIndex(now);
+
+    const auto IT = std::upper_bound(m_vIndex.begin(), m_vIndex.end(), now, [](const auto& time, const auto& t) { return time < t.at; });
+
+    if (IT == m_vIndex.begin())
+        return -1;
+
+    return std::prev(IT)->profile;
+}
+
+std::optional<std::pair<std::chrono::sys_seconds, int>> CProfileSchedule::next(std::chrono::system_clock::time_point now) {
+    ensureIndex(now);
+
+    const auto IT = std::upper_bound(m_vIndex.begin(), m_vIndex.end(), now, [](const auto& time, const auto& t) { return time < t.at; });
+
+    if (IT == m_vIndex.end())
+        return std::nullopt;
+
+    return std::pair{IT->at, IT->profile};
+}
+
+std::optional<SScheduleSample> CProfileSchedule::sample(std::chrono::system_clock::time_point now) {
+    ensureIndex(now);
+
+    const auto IT = std::upper_bound(m_vIndex.begin(), m_vIndex.end(), now, [](const auto& time, const auto& t) { return time < t.at; });
+
+    if (IT == m_vIndex.begin())
+        return std::nullopt;
+
+    const auto&     FROM = m_vProfiles[std::prev(IT)->profile];
+    SScheduleSample result{.profile = std::prev(IT)->profile, .temperature = FROM.temperature, .gamma = FROM.gamma, .identity = FROM.identity};
+
+    if (IT == m_vIndex.end() || !m_vProfiles[IT->profile].interpolate)
+        return result;
+
+    const auto&  TO       = m_vProfiles[IT->profile];
+    const double PROGRESS = std::chrono::duration<double>(now - std::prev(IT)->at) / std::chrono::duration<double>(IT->at - std::prev(IT)->at);
+    const double EASED    = CTransition::ease(*TO.interpolate, std::clamp(PROGRESS, 0.0, 1.0));
+
+    result.temperature = std::lround(FROM.temperature + ((double)TO.temperature - FROM.temperature) * EASED);
+    result.gamma       = FROM.gamma + (TO.gamma - FROM.gamma) * EASED;
+
+    return result;
+}
+
+std::optional<std::chrono::system_clock::time_point> CProfileSchedule::nextChange(std::chrono::system_clock::time_point now, unsigned long temperatureStep, float gammaStep) {
+    ensureIndex(now);
+
+    const auto IT = std::upper_bound(m_vIndex.begin(), m_vIndex.end(), now, [](const auto& time, const auto& t) { return time < t.at; });
+
+    if (IT == m_vIndex.end())
+        return std::nullopt;
+
+    if (IT == m_vIndex.begin() || !m_vProfiles[IT->profile].interpolate)
+        return IT->at;
+
+    const auto&  FROM  = m_vProfiles[std::prev(IT)->profile];
+    const auto&  TO    = m_vProfiles[IT->profile];
+    const auto   CURVE = *TO.interpolate;
+    const auto   BEGIN = std::chrono::system_clock::time_point{std::prev(IT)->at};
+    const double SPAN  = std::chrono::duration<double>(IT->at - std::prev(IT)->at).count();
+
+    // how much of the eased progress makes up a step of either value, the smaller one wins
+    const double TEMPERATUREDELTA = std::abs((double)TO.temperature - FROM.temperature);
+    const double GAMMADELTA       = std::abs(TO.gamma - FROM.gamma);
+    double       step             = 1;
+    if (TEMPERATUREDELTA > 0)
+        step = std::min(step, temperatureStep / TEMPERATUREDELTA);
+    if (GAMMADELTA > 0)
+        step = std::min(step, gammaStep / GAMMADELTA);
+
+    const double NOW    = std::clamp(std::chrono::duration<double>(now - BEGIN).count() / SPAN, 0.0, 1.0);
+    const double TARGET = CTransition::ease(CURVE, NOW) + step;
+
+    if (TARGET >= 1)
+        return IT->at;
+
+    // the curves are monotonic, bisect for where the eased progress reaches the target
+    double lo = NOW, hi = 1;
+    for (int i = 0; i < RAMP_BISECT_ITERATIONS; ++i) {
+        const double MID = (lo + hi) / 2;
+        if (CTransition::ease(CURVE, MID) < TARGET)
+            lo = MID;
+        else
+            hi = MID;
+    }
+
+    const auto AT = BEGIN + std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::duration<double>(hi * SPAN));
+
+    // steep ramps would otherwise wake up back to back, a step per second is as fast as they go
+    return std::min<std::chrono::system_clock::time_point>(std::max(AT, now + std::chrono::seconds{RAMP_MIN_INTERVAL}), IT->at);
+}
+
+void CProfileSchedule::ensureIndex(std::chrono::system_clock::time_point now) {
+    if (m_bValid && now >= m_validFrom && now < m_validUntil)
+        return;
+
+    rebuild(now);
+}
+
+void CProfileSchedule::appendDay(std::chrono::local_days day, const std::chrono::time_zone* zone, std::vector<STransition>& out) const {
+    const std::chrono::year_month_day DATE{day};
+
+    // the sun's times for the day, the only place they're computed
+    std::array<std::optional<std::chrono::sys_seconds>, SOLAR_EVENT_DUSK + 1> solar;
+    if (m_bAnchored && m_location) {
+        for (const auto EVENT : {SOLAR_EVENT_DAWN, SOLAR_EVENT_SUNRISE, SOLAR_EVENT_SUNSET, SOLAR_EVENT_DUSK}) {
+            solar[EVENT] = Solar::eventOn(DATE, *m_location, EVENT);
+        }
+    }
+
+    for (size_t i = 0; i < m_vProfiles.size(); ++i) {
+        const auto& PROFILE = m_vProfiles[i];
+
+        if (!PROFILE.appliesOn(DATE))
+            continue;
+
+        if (PROFILE.anchor != SOLAR_EVENT_NONE) {
+            // the sun doesn't rise or set that day (or there's no location), the profile sits it out
+            if (!solar[PROFILE.anchor])
+                continue;
+
+            out.emplace_back(STransition{.at = *solar[PROFILE.anchor] + PROFILE.offset, .profile = (int)i});
+            continue;
+        }
+
+        // a switch inside a DST gap happens at the moment the gap starts
+        const auto AT = zone->to_sys(day + PROFILE.time.hour + PROFILE.time.minute, std::chrono::choose::earliest);
+        out.emplace_back(STransition{.at = std::chrono::floor<std::chrono::seconds>(AT), .profile = (int)i});
+    }
+}
+
+void CProfileSchedule::rebuild(std::chrono::system_clock::time_point now) {
+    const auto ZONE  = zone();
+    const auto TODAY = std::chrono::floor<std::chrono::days>(ZONE->to_local(now));
+    const auto INFO  = ZONE->get_info(now);
+
+    // the offset's begin and end can be the min / max of sys_seconds, clamp before going to the clock's precision
+    m_vIndex.clear();
+    m_bValid     = true;
+    m_validFrom  = std::max<std::chrono::sys_seconds>(ZONE->to_sys(TODAY, std::chrono::choose::earliest), INFO.begin);
+    m_validUntil = std::min<std::chrono::sys_seconds>(ZONE->to_sys(TODAY + std::chrono::days{1}, std::chrono::choose::earliest), INFO.end);
+
+    if (m_vProfiles.empty())
+        return;
+
+    // whatever switched last before today is still active at midnight. keep that whole day, an anchored switch of it can run past midnight
+    for (int back = 1; back <= SCHEDULE_SEARCH_DAYS && m_vIndex.empty(); ++back) {
+        appendDay(TODAY - std::chrono::days{back}, ZONE, m_vIndex);
+    }
+
+    // and at least one switch after now, so there's always a next one to sleep until
+    for (int ahead = 0; ahead < SCHEDULE_INDEX_DAYS + SCHEDULE_SEARCH_DAYS; ++ahead) {
+        if (ahead >= SCHEDULE_INDEX_DAYS && !m_vIndex.empty() && m_vIndex.back().at > now)
+            break;
+
+        appendDay(TODAY + std::chrono::days{ahead}, ZONE, m_vIndex);
+    }
+
+    // anchored switches move around the clock ones from day to day
+    std::ranges::stable_sort(m_vIndex, [](const auto& a, const auto& b) { return a.at < b.at; });
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Transition.hpp"
+#include "helpers/Solar.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// weekday bits, sunday is bit 0 like std::chrono::weekday::c_encoding()
+inline constexpr uint8_t DAYS_ALL      = 0x7f;
+inline constexpr uint8_t DAYS_WEEKDAYS = 0x3e;
+inline constexpr uint8_t DAYS_WEEKENDS = 0x41;
+
+// inclusive on both ends, from after to wraps around the new year (e.g. 11-01..03-31)
+struct SDateRange {
+    std::chrono::month_day from, to;
+
+    bool                   contains(std::chrono::month_day day) const;
+    bool                   operator==(const SDateRange&) const = default;
+};
+
+struct SSunsetProfile {
+    struct STime {
+        std::chrono::hours   hour;
+        std::chrono::minutes minute;
+
+        bool                 operator==(const STime&) const = default;
+    } time;
+
+    // set for profiles like sunset-30m, which switch at the event plus offset and ignore time
+    eSolarEvent               anchor = SOLAR_EVENT_NONE;
+    std::chrono::minutes      offset{0};
+
+    unsigned long             temperature = 6000;
+    float                     gamma       = 1.0f;
+    bool                      identity    = false;
+
+    // ramp from the previous profile's values into this one's along the curve, reaching them at time. unset switches at time
+    std::optional<eTransitionCurve> interpolate;
+
+    uint8_t                         days = DAYS_ALL;
+    std::optional<SDateRange>       dates; // every day of the year if unset
+
+    bool                            appliesOn(std::chrono::year_month_day date) const;
+    // as written in the config, HH:MM or event[+-offset]
+    std::string               timeString() const;
+    bool                      operator==(const SSunsetProfile&) const = default;
+};
+
+// what the schedule asks for at some point in time
+struct SScheduleSample {
+    int           profile     = -1; // the last one switched to, a ramp reaches the next one at its switch
+    unsigned long temperature = 6000;
+    float         gamma       = 1.0f;
+    bool          identity    = false;
+};
+
+// The profiles unrolled into a sorted list of switches around today, finding the active and the next one is a binary search.
+// Rebuilt on the first lookup after the profiles changed, the local date rolled over or the UTC offset changed, never per lookup.
+// Sun times for profiles anchored to one are worked out during the rebuild as well, so that's once a day.
+class CProfileSchedule {
+  public:
+    // sorts them by time of day, indices returned below refer to this order
+    void                                                    setProfiles(std::vector<SSunsetProfile> profiles);
+    const std::vector<SSunsetProfile>&                      profiles() const;
+    // needed by anchored profiles, without one they never switch
+    void                                                    setLocation(std::optional<SLocation> location);
+    const std::optional<SLocation>&                         location() const;
+
+    // switches are worked out in this zone, nullptr follows the system's (current_zone())
+    void                                                    setZone(const std::chrono::time_zone* zone);
+    const std::chrono::time_zone*                           zone() const;
+
+    // the timezone changed, rebuild on the next lookup
+    void                                                    invalidate();
+
+    // the profile active at now, -1 if there is none
+    int                                                     current(std::chrono::system_clock::time_point now);
+    // the first switch after now and the profile it switches to
+    std::optional<std::pair<std::chrono::sys_seconds, int>> next(std::chrono::system_clock::time_point now);
+
+    // the values at now, somewhere along a ramp if the next profile interpolates. nullopt if no profile is active
+    std::optional<SScheduleSample>                          sample(std::chrono::system_clock::time_point now);
+    // when sample() will have moved by either step from its value at now, the next switch if that comes first or nothing ramps
+    std::optional<std::chrono::system_clock::time_point>    nextChange(std::chrono::system_clock::time_point now, unsigned long temperatureStep, float gammaStep);
+
+  private:
+    struct STransition {
+        std::chrono::sys_seconds at;
+        int                      profile = -1;
+    };
+
+    void                                  ensureIndex(std::chrono::system_clock::time_point now);
+    void                                  rebuild(std::chrono::system_clock::time_point now);
+    void                                  appendDay(std::chrono::local_days day, const std::chrono::time_zone* zone, std::vector<STransition>& out) const;
+
+    std::vector<SSunsetProfile>           m_vProfiles;
+    std::vector<STransition>              m_vIndex;
+    std::optional<SLocation>              m_location;
+    const std::chrono::time_zone*         m_pZone     = nullptr;
+    bool                                  m_bAnchored = false;
+
+    // the index is good while the local date and the utc offset stay what they were at the rebuild
+    bool                                  m_bValid = false;
+    std::chrono::system_clock::time_point m_validFrom, m_validUntil;
+};
@@ -0,0 +1,113 @@
+#include "Snapshot.hpp"
+#include "Hyprsunset.hpp"
+#include "helpers/Hash.hpp"
+#include "helpers/Log.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <unistd.h>
+
+#define SNAPSHOT_MAGIC   0x70616e73 // "snap"
+#define SNAPSHOT_VERSION 1
+
+static uint64_t checksum(const SSnapshotFile& file) {
+    const auto BEGIN = offsetof(SSnapshotFile, fingerprint);
+    const auto END   = offsetof(SSnapshotFile, output) + std::min<uint32_t>(file.outputs, SNAPSHOT_MAX_OUTPUTS) * sizeof(SSnapshotFile::SOutputEntry);
+
+    return Hash::fnv1a(std::string_view{(const char*)&file + BEGIN, END - BEGIN});
+}
+
+CSnapshot::CSnapshot() {
+    if (const auto STATE = getenv("XDG_STATE_HOME"); STATE && *STATE)
+        m_szPath = STATE + std::string{"/hyprsunset/snapshot"};
+    else if (const auto HOME = getenv("HOME"); HOME)
+        m_szPath = HOME + std::string{"/.local/state/hyprsunset/snapshot"};
+}
+
+CSnapshot::~CSnapshot() {
+    if (m_iFD >= 0)
+        close(m_iFD);
+}
+
+bool CSnapshot::load(uint64_t fingerprint) {
+    if (m_szPath.empty())
+        return false;
+
+    const int FD = open(m_szPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (FD < 0)
+        return false;
+
+    SSnapshotFile file;
+    const auto    LEN = read(FD, &file, sizeof(file));
+    close(FD);
+
+    if (LEN != sizeof(file) || file.magic != SNAPSHOT_MAGIC || file.version != SNAPSHOT_VERSION || file.outputs > SNAPSHOT_MAX_OUTPUTS || file.checksum != checksum(file)) {
+        Debug::log<LOG>("Snapshot at {} is damaged or from another version, ignoring it", m_szPath);
+        return false;
+    }
+
+    if (file.fingerprint != fingerprint) {
+        Debug::log<LOG>("Snapshot was written for another config, ignoring it");
+        return false;
+    }
+
+    m_file = file;
+    return true;
+}
+
+Mat3x3 CSnapshot::ctm() const {
+    return std::to_array(m_file.ctm);
+}
+
+Mat3x3 CSnapshot::ctmFor(std::string_view output) const {
+    for (uint32_t i = 0; i < m_file.outputs; ++i) {
+        if (output == m_file.output[i].name)
+            return std::to_array(m_file.output[i].ctm);
+    }
+
+    return ctm();
+}
+
+float CSnapshot::exponent() const {
+    return m_file.exponent;
+}
+
+void CSnapshot::save(uint64_t fingerprint, const SState& state) {
+    if (m_szPath.empty())
+        return;
+
+    if (m_iFD < 0) {
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path{m_szPath}.parent_path(), ec);
+
+        m_iFD = open(m_szPath.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+        if (m_iFD < 0) {
+            Debug::log<WARN>("Couldn't write the snapshot to {}: {}, restarts will start from white", m_szPath, strerror(errno));
+            m_szPath.clear();
+            return;
+        }
+    }
+
+    SSnapshotFile file{.magic = SNAPSHOT_MAGIC, .version = SNAPSHOT_VERSION, .fingerprint = fingerprint, .exponent = state.lutExponent};
+    std::ranges::copy(state.ctm.getMatrix(), file.ctm);
+
+    for (const auto& o : state.outputs | std::views::values) {
+        // nameless ones couldn't be matched on the next start anyway
+        if (!o->sent || o->name.empty() || file.outputs >= SNAPSHOT_MAX_OUTPUTS)
+            continue;
+
+        auto& entry = file.output[file.outputs++];
+        o->name.copy(entry.name, SNAPSHOT_NAME_SIZE - 1);
+        std::ranges::copy(o->ctm.getMatrix(), entry.ctm);
+    }
+
+    file.checksum = checksum(file);
+
+    // the same size every time, the file never needs truncating
+    if (pwrite(m_iFD, &file, sizeof(file), 0) != sizeof(file))
+        Debug::log<LOG>("Short write on the snapshot: {}", strerror(errno));
+}
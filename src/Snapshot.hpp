@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include <hyprutils/math/Mat3x3.hpp>
+using namespace Hyprutils::Math;
+
+struct SState;
+
+#define SNAPSHOT_MAX_OUTPUTS 16
+#define SNAPSHOT_NAME_SIZE   32
+
+// the file as written, native endianness since only this machine reads it
+struct SSnapshotFile {
+    struct SOutputEntry {
+        char  name[SNAPSHOT_NAME_SIZE];
+        float ctm[9];
+    };
+
+    uint32_t     magic       = 0;
+    uint32_t     version     = 0;
+    uint64_t     checksum    = 0; // of what follows, up to the last used entry. a crash mid write leaves a mismatch
+    uint64_t     fingerprint = 0;
+    float        ctm[9]      = {};
+    float        exponent    = 1.0f;
+    uint32_t     outputs     = 0;
+    SOutputEntry output[SNAPSHOT_MAX_OUTPUTS];
+};
+
+// What was last sent to the compositor, rewritten once commits settle. At startup it goes back on screen as soon as the outputs are bound, before
+// the config is parsed, so a restart doesn't flash uncorrected white. Only trusted for the config (and arguments) it was written with, the
+// parsed config corrects it right after anyway.
+class CSnapshot {
+  public:
+    // $XDG_STATE_HOME/hyprsunset/snapshot, ~/.local/state without it
+    CSnapshot();
+    ~CSnapshot();
+
+    // false if there's none, it's damaged or it was written for another fingerprint
+    bool   load(uint64_t fingerprint);
+    // for the global matrix, valid after load
+    Mat3x3 ctm() const;
+    // the matrix last sent to the output, the global one for outputs that weren't there then
+    Mat3x3 ctmFor(std::string_view output) const;
+    float  exponent() const;
+
+    // one pwrite over the previous one
+    void   save(uint64_t fingerprint, const SState& state);
+
+  private:
+    std::string   m_szPath;
+    int           m_iFD = -1; // opened by the first save
+    SSnapshotFile m_file;
+};
@@ -0,0 +1,82 @@
+#include "StatusPage.hpp"
+#include "helpers/Log.hpp"
+
+#include <cstring>
+#include <new>
+
+CStatusPage::CStatusPage() : m_szPath(Hyprsunset::statusPagePath()) {
+    // the socket creates it too, but only without hyprland
+    mkdir(m_szPath.substr(0, m_szPath.find_last_of('/')).c_str(), S_IRWXU);
+
+    // filled in under another name, readers never see a page without its header
+    const auto TMPPATH = m_szPath + ".tmp";
+    const int  FD      = open(TMPPATH.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (FD < 0) {
+        Debug::log<ERR>("Couldn't create the status page at {}: {}", TMPPATH, strerror(errno));
+        return;
+    }
+
+    if (ftruncate(FD, sizeof(Hyprsunset::SStatusPage)) < 0) {
+        Debug::log<ERR>("Couldn't size the status page: {}", strerror(errno));
+        close(FD);
+        unlink(TMPPATH.c_str());
+        return;
+    }
+
+    const auto MAP = mmap(nullptr, sizeof(Hyprsunset::SStatusPage), PROT_READ | PROT_WRITE, MAP_SHARED, FD, 0);
+    close(FD);
+
+    if (MAP == MAP_FAILED) {
+        Debug::log<ERR>("Couldn't map the status page: {}", strerror(errno));
+        unlink(TMPPATH.c_str());
+        return;
+    }
+
+    m_pPage = new (MAP) Hyprsunset::SStatusPage{};
+
+    if (rename(TMPPATH.c_str(), m_szPath.c_str()) < 0) {
+        Debug::log<ERR>("Couldn't move the status page to {}: {}", m_szPath, strerror(errno));
+        munmap(m_pPage, sizeof(Hyprsunset::SStatusPage));
+        m_pPage = nullptr;
+        unlink(TMPPATH.c_str());
+        return;
+    }
+
+    Debug::log<LOG>("Status page at {}", m_szPath);
+}
+
+CStatusPage::~CStatusPage() {
+    if (!m_pPage)
+        return;
+
+    // readers that still have it mapped find out from this, the file itself is gone for new ones
+    m_pPage->closed.store(1, std::memory_order_release);
+    unlink(m_szPath.c_str());
+    munmap(m_pPage, sizeof(Hyprsunset::SStatusPage));
+}
+
+bool CStatusPage::valid() const {
+    return m_pPage;
+}
+
+void CStatusPage::publish(const Hyprsunset::SStatus& status) {
+    if (!m_pPage)
+        return;
+
+    const auto SEQUENCE = m_pPage->sequence.load(std::memory_order_relaxed);
+
+    // odd: readers that start now retry, ones that started before see the change and retry as well
+    m_pPage->sequence.store(SEQUENCE + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_pPage->temperature.store(status.temperature, std::memory_order_relaxed);
+    m_pPage->gamma.store(status.gamma, std::memory_order_relaxed);
+    m_pPage->identity.store(status.identity, std::memory_order_relaxed);
+    m_pPage->profile.store(status.profile, std::memory_order_relaxed);
+    m_pPage->nextTransition.store(status.nextTransition, std::memory_order_relaxed);
+    for (size_t c = 0; c < Hyprsunset::STATUS_PROFILE_SIZE; ++c) {
+        m_pPage->profileTime[c].store(status.profileTime[c], std::memory_order_relaxed);
+    }
+
+    m_pPage->sequence.store(SEQUENCE + 2, std::memory_order_release);
+}
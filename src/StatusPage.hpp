@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../include/hyprsunset/StatusPage.hpp"
+
+#include <memory>
+#include <string>
+
+// The writing side of include/hyprsunset/StatusPage.hpp. Only the main thread publishes, so the seqlock needs no writer lock.
+class CStatusPage {
+  public:
+    // creates the file, valid() is false if it couldn't
+    CStatusPage();
+    ~CStatusPage();
+
+    bool valid() const;
+    // sequence is ignored, the page keeps its own
+    void publish(const Hyprsunset::SStatus& status);
+
+  private:
+    std::string              m_szPath;
+    Hyprsunset::SStatusPage* m_pPage = nullptr;
+};
+
+inline std::unique_ptr<CStatusPage> g_pStatusPage;
@@ -0,0 +1,68 @@
+#include "Transition.hpp"
+
+#include <algorithm>
+#include <array>
+
+void CTransition::start(std::chrono::milliseconds duration, eTransitionCurve curve) {
+    m_begin    = clock::now();
+    m_duration = duration;
+    m_curve    = curve;
+    m_active   = duration.count() > 0;
+}
+
+void CTransition::cancel() {
+    m_active = false;
+}
+
+bool CTransition::active() const {
+    return m_active;
+}
+
+float CTransition::ease(eTransitionCurve curve, float t) {
+    switch (curve) {
+        case CURVE_LINEAR: return t;
+        case CURVE_EASE_IN: return t * t * t;
+        case CURVE_EASE_OUT: return 1.F - (1.F - t) * (1.F - t) * (1.F - t);
+        case CURVE_EASE_IN_OUT: return t < 0.5F ? 4.F * t * t * t : 1.F - (-2.F * t + 2.F) * (-2.F * t + 2.F) * (-2.F * t + 2.F) / 2.F;
+    }
+
+    return t;
+}
+
+float CTransition::progress(clock::time_point now) {
+    if (!m_active)
+        return 1.F;
+
+    const auto ELAPSED = now - m_begin;
+    if (ELAPSED >= m_duration) {
+        m_active = false;
+        return 1.F;
+    }
+
+    return ease(m_curve, std::clamp(std::chrono::duration<float>(ELAPSED) / std::chrono::duration<float>(m_duration), 0.F, 1.F));
+}
+
+Mat3x3 CTransition::interpolate(const Mat3x3& from, const Mat3x3& to, float progress) {
+    const auto           FROM = from.getMatrix();
+    const auto           TO   = to.getMatrix();
+    std::array<float, 9> result;
+
+    for (size_t i = 0; i < result.size(); ++i) {
+        result[i] = FROM[i] + (TO[i] - FROM[i]) * progress;
+    }
+
+    return result;
+}
+
+std::optional<eTransitionCurve> CTransition::curveFromString(const std::string& str) {
+    if (str == "linear")
+        return CURVE_LINEAR;
+    if (str == "ease-in")
+        return CURVE_EASE_IN;
+    if (str == "ease-out")
+        return CURVE_EASE_OUT;
+    if (str == "ease-in-out")
+        return CURVE_EASE_IN_OUT;
+
+    return std::nullopt;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <hyprutils/math/Mat3x3.hpp>
+using namespace Hyprutils::Math;
+
+enum eTransitionCurve : uint8_t {
+    CURVE_LINEAR = 0,
+    CURVE_EASE_IN,
+    CURVE_EASE_OUT,
+    CURVE_EASE_IN_OUT,
+};
+
+class CTransition {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    // starts (or restarts, if one is running) a transition, callers keep the matrices per output
+    void                                   start(std::chrono::milliseconds duration, eTransitionCurve curve);
+    void                                   cancel();
+
+    bool                                   active() const;
+
+    // eased progress in [0, 1] at now, finishes the transition once the duration has passed
+    float                                  progress(clock::time_point now);
+
+    static Mat3x3                          interpolate(const Mat3x3& from, const Mat3x3& to, float progress);
+    static std::optional<eTransitionCurve> curveFromString(const std::string& str);
+    // t in [0, 1], every curve is monotonic
+    static float                           ease(eTransitionCurve curve, float t);
+
+  private:
+    clock::time_point m_begin;
+    clock::duration   m_duration = {};
+    eTransitionCurve  m_curve    = CURVE_LINEAR;
+    bool              m_active   = false;
+};
@@ -0,0 +1,26 @@
+#include "CTMBackend.hpp"
+#include "../helpers/Matrix.hpp"
+
+CCTMBackend::CCTMBackend(SP<CCHyprlandCtmControlManagerV1> manager) : m_pManager(manager) {
+    ;
+}
+
+std::string_view CCTMBackend::name() const {
+    return "ctm";
+}
+
+uint8_t CCTMBackend::capabilities() const {
+    return BACKEND_CAPABILITY_MATRIX | BACKEND_CAPABILITY_ATOMIC;
+}
+
+bool CCTMBackend::apply(SOutput& output, const Mat3x3& ctm, float exponent) {
+    const auto ARR = fixedFromMatrix(ctm);
+
+    m_pManager->sendSetCtmForOutput(output.output->resource(), ARR[0], ARR[1], ARR[2], ARR[3], ARR[4], ARR[5], ARR[6], ARR[7], ARR[8]);
+
+    return true;
+}
+
+void CCTMBackend::commit() {
+    m_pManager->sendCommit();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "IOutputBackend.hpp"
+#include "../Hyprsunset.hpp"
+
+// hyprland-ctm-control-v1: a matrix per output, shown on commit
+class CCTMBackend : public IOutputBackend {
+  public:
+    CCTMBackend(SP<CCHyprlandCtmControlManagerV1> manager);
+
+    std::string_view name() const override;
+    uint8_t          capabilities() const override;
+
+    bool             apply(SOutput& output, const Mat3x3& ctm, float exponent) override;
+    void             commit() override;
+
+  private:
+    SP<CCHyprlandCtmControlManagerV1> m_pManager;
+};
@@ -0,0 +1,96 @@
+#include "GammaBackend.hpp"
+#include "../helpers/Log.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+CGammaBackend::CGammaBackend(SP<CCZwlrGammaControlManagerV1> manager) : m_pManager(manager) {
+    ;
+}
+
+std::string_view CGammaBackend::name() const {
+    return "gamma";
+}
+
+uint8_t CGammaBackend::capabilities() const {
+    return BACKEND_CAPABILITY_CURVE;
+}
+
+void CGammaBackend::outputAdded(SOutput& output) {
+    if (m_mOutputs.contains(output.id))
+        return;
+
+    const auto ID = output.id;
+    auto&      o  = m_mOutputs[ID];
+
+    o.control = makeShared<CCZwlrGammaControlV1>(m_pManager->sendGetGammaControl(output.output->resource()));
+
+    o.control->setGammaSize([this, ID](CCZwlrGammaControlV1*, uint32_t size) {
+        const auto IT = m_mOutputs.find(ID);
+        if (IT == m_mOutputs.end())
+            return;
+
+        auto& ramp = IT->second.ramp;
+        ramp       = makeUnique<CGammaRamp>(size);
+        if (!ramp->valid()) {
+            Debug::log<ERR>("Couldn't allocate a gamma table of {} entries for output {}", size, ID);
+            ramp.reset();
+            return;
+        }
+
+        Debug::log<LOG>("Output {} has gamma tables of {} entries", ID, size);
+
+        if (onOutputUsable)
+            onOutputUsable(ID);
+    });
+
+    o.control->setFailed([this, ID](CCZwlrGammaControlV1*) {
+        Debug::log<ERR>("Lost the gamma control of output {}, another client may have taken it", ID);
+
+        // erasing it here would destroy the control and this very callback while it runs
+        if (const auto IT = m_mOutputs.find(ID); IT != m_mOutputs.end()) {
+            IT->second.failed = true;
+            IT->second.ramp.reset();
+        }
+    });
+}
+
+void CGammaBackend::outputRemoved(SOutput& output) {
+    m_mOutputs.erase(output.id);
+}
+
+bool CGammaBackend::apply(SOutput& output, const Mat3x3& ctm, float exponent) {
+    const auto IT = m_mOutputs.find(output.id);
+
+    // the failed event is long done by now, the control can go
+    if (IT != m_mOutputs.end() && IT->second.failed) {
+        m_mOutputs.erase(IT);
+        return false;
+    }
+
+    // no size yet, the table is sent once it's known
+    if (IT == m_mOutputs.end() || !IT->second.ramp)
+        return false;
+
+    auto&      o   = IT->second;
+    const auto MAT = ctm.getMatrix();
+
+    // our matrices only ever have a diagonal, which is what a table per channel can do
+    o.ramp->fill({MAT[0], MAT[4], MAT[8]}, exponent);
+
+    const auto FD = o.ramp->exportFD();
+    if (FD < 0) {
+        Debug::log<ERR>("Couldn't share the gamma table of {}: {}", output.name, strerror(errno));
+        return false;
+    }
+
+    o.control->sendSetGamma(FD);
+    close(FD);
+
+    return true;
+}
+
+void CGammaBackend::commit() {
+    ;
+}
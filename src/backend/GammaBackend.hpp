@@ -0,0 +1,33 @@
+#pragma once
+
+#include "IOutputBackend.hpp"
+#include "../Hyprsunset.hpp"
+#include "../helpers/GammaRamp.hpp"
+#include "protocols/wlr-gamma-control-unstable-v1.hpp"
+
+#include <unordered_map>
+
+// wlr-gamma-control-unstable-v1: a table per channel, which is only the matrix' diagonal but can take a curve. tables apply as they're set
+class CGammaBackend : public IOutputBackend {
+  public:
+    CGammaBackend(SP<CCZwlrGammaControlManagerV1> manager);
+
+    std::string_view name() const override;
+    uint8_t          capabilities() const override;
+
+    void             outputAdded(SOutput& output) override;
+    void             outputRemoved(SOutput& output) override;
+
+    bool             apply(SOutput& output, const Mat3x3& ctm, float exponent) override;
+    void             commit() override;
+
+  private:
+    struct SGammaOutput {
+        SP<CCZwlrGammaControlV1> control;
+        UP<CGammaRamp>           ramp;           // once the compositor sent the size
+        bool                     failed = false; // dropped on the next apply, not from inside its own failed event
+    };
+
+    SP<CCZwlrGammaControlManagerV1>            m_pManager;
+    std::unordered_map<uint32_t, SGammaOutput> m_mOutputs; // by output id
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string_view>
+
+#include <hyprutils/math/Mat3x3.hpp>
+using namespace Hyprutils::Math;
+
+struct SOutput;
+
+enum eBackendType : uint8_t {
+    BACKEND_AUTO = 0, // ctm control, gamma tables if the compositor lacks it
+    BACKEND_CTM,
+    BACKEND_GAMMA,
+    BACKEND_NULL,
+};
+
+enum eBackendCapability : uint8_t {
+    BACKEND_CAPABILITY_MATRIX = (1 << 0), // full matrices, otherwise only the diagonal is used
+    BACKEND_CAPABILITY_CURVE  = (1 << 1), // lut:exponent
+    BACKEND_CAPABILITY_ATOMIC = (1 << 2), // nothing shows before commit, all outputs change together
+};
+
+// Where the color state ends up. The daemon keeps track of what each output was sent, a backend gets apply for outputs whose state changed
+// followed by a single commit.
+class IOutputBackend {
+  public:
+    virtual ~IOutputBackend() = default;
+
+    virtual std::string_view name() const         = 0;
+    virtual uint8_t          capabilities() const = 0;
+
+    virtual void             outputAdded(SOutput& output) {}
+    virtual void             outputRemoved(SOutput& output) {}
+
+    // false if the output can't take state yet, onOutputUsable is called once it can
+    virtual bool apply(SOutput& output, const Mat3x3& ctm, float exponent) = 0;
+    virtual void commit()                                                  = 0;
+
+    // with the output's id
+    std::function<void(uint32_t)> onOutputUsable;
+};
+
+namespace Backend {
+    constexpr std::optional<eBackendType> typeFromName(std::string_view name) {
+        if (name == "auto")
+            return BACKEND_AUTO;
+        if (name == "ctm")
+            return BACKEND_CTM;
+        if (name == "gamma")
+            return BACKEND_GAMMA;
+        if (name == "null")
+            return BACKEND_NULL;
+
+        return std::nullopt;
+    }
+}
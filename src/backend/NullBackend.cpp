@@ -0,0 +1,39 @@
+#include "NullBackend.hpp"
+#include "../Hyprsunset.hpp"
+
+// a long running daemon would grow without bound otherwise
+#define NULL_BACKEND_HISTORY 4096
+
+std::string_view CNullBackend::name() const {
+    return "null";
+}
+
+uint8_t CNullBackend::capabilities() const {
+    return BACKEND_CAPABILITY_MATRIX | BACKEND_CAPABILITY_CURVE | BACKEND_CAPABILITY_ATOMIC;
+}
+
+bool CNullBackend::apply(SOutput& output, const Mat3x3& ctm, float exponent) {
+    if (m_dHistory.size() >= NULL_BACKEND_HISTORY)
+        m_dHistory.pop_front();
+
+    m_dHistory.emplace_back(SRecordedState{.output = output.id, .name = output.name, .ctm = ctm, .exponent = exponent, .commit = m_iCommits + 1});
+
+    return true;
+}
+
+void CNullBackend::commit() {
+    ++m_iCommits;
+}
+
+const std::deque<SRecordedState>& CNullBackend::history() const {
+    return m_dHistory;
+}
+
+uint64_t CNullBackend::commits() const {
+    return m_iCommits;
+}
+
+void CNullBackend::clear() {
+    m_dHistory.clear();
+    m_iCommits = 0;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "IOutputBackend.hpp"
+
+#include <cstddef>
+#include <deque>
+#include <string>
+
+// one apply call
+struct SRecordedState {
+    uint32_t    output = 0;
+    std::string name;
+    Mat3x3      ctm;
+    float       exponent = 1.0f;
+    uint64_t    commit   = 0; // the commit it went out with
+};
+
+// Sends nothing anywhere and keeps what it got in memory, for running the daemon without a compositor (--backend null, CI, benchmarks).
+class CNullBackend : public IOutputBackend {
+  public:
+    std::string_view                  name() const override;
+    uint8_t                           capabilities() const override;
+
+    bool                              apply(SOutput& output, const Mat3x3& ctm, float exponent) override;
+    void                              commit() override;
+
+    // the most recent ones, oldest first
+    const std::deque<SRecordedState>& history() const;
+    uint64_t                          commits() const;
+    void                              clear();
+
+  private:
+    std::deque<SRecordedState> m_dHistory;
+    uint64_t                   m_iCommits = 0;
+};
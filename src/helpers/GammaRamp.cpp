@@ -0,0 +1,146 @@
+#include "GammaRamp.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// passing these between the inlined helpers has no abi to speak of, gcc warns about avx sized vectors regardless
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+// 8 lanes: two sse registers, one avx one
+typedef float    vfloat __attribute__((vector_size(32)));
+typedef int32_t  vint __attribute__((vector_size(32)));
+typedef uint16_t vu16 __attribute__((vector_size(16)));
+
+#define RAMP_LANES 8
+
+// the avx2 clone is picked at load time where the cpu has it
+#if defined(__x86_64__)
+#define RAMP_TARGET_CLONES __attribute__((target_clones("avx2", "default")))
+#else
+#define RAMP_TARGET_CLONES
+#endif
+
+[[gnu::always_inline]] static inline vfloat select(vint mask, vfloat a, vfloat b) {
+    return (vfloat)(((vint)a & mask) | ((vint)b & ~mask));
+}
+
+// x > 0. the exponent from the bits, the mantissa moved to [sqrt(1/2), sqrt(2)) and log(m) = 2 atanh((m - 1) / (m + 1)) as a series, which is
+// past float precision after four terms there
+[[gnu::always_inline]] static inline vfloat log2v(vfloat x) {
+    const auto BITS = (vint)x;
+    auto       e    = ((BITS >> 23) & 0xff) - 127;
+    auto       m    = (vfloat)((BITS & 0x007fffff) | 0x3f800000);
+
+    const vint BIG = m > 1.41421356f;
+    m              = select(BIG, m * 0.5f, m);
+    e              = e - BIG;
+
+    const auto T  = (m - 1.f) / (m + 1.f);
+    const auto T2 = T * T;
+    const auto LN = 2.f * T * (1.f + T2 * (1.f / 3.f + T2 * (1.f / 5.f + T2 * (1.f / 7.f))));
+
+    return __builtin_convertvector(e, vfloat) + LN * 1.44269504f;
+}
+
+// y in [-126, 0]. 2^floor(y) goes straight into the exponent bits, 2^fraction is a taylor series of e^(f ln 2), within 2e-6
+[[gnu::always_inline]] static inline vfloat exp2v(vfloat y) {
+    y = select(y < -126.f, vfloat{} - 126.f, y);
+
+    // truncated towards zero, one less is the floor for negatives
+    auto       i     = __builtin_convertvector(y, vint);
+    const vint ABOVE = __builtin_convertvector(i, vfloat) > y;
+    i                = i + ABOVE;
+
+    const auto R = (y - __builtin_convertvector(i, vfloat)) * 0.69314718f;
+    const auto P = 1.f + R * (1.f + R * (1.f / 2.f + R * (1.f / 6.f + R * (1.f / 24.f + R * (1.f / 120.f + R * (1.f / 720.f + R * (1.f / 5040.f)))))));
+
+    return (vfloat)((vint)P + (i << 23));
+}
+
+RAMP_TARGET_CLONES void GammaRamp::fill(uint16_t* table, uint32_t size, const std::array<float, 3>& scale, float exponent) {
+    if (size == 0)
+        return;
+
+    const float STEP   = size > 1 ? 1.f / (size - 1) : 0.f;
+    const bool  LINEAR = exponent == 1.f;
+
+    vfloat      index;
+    for (int i = 0; i < RAMP_LANES; ++i) {
+        index[i] = i;
+    }
+
+    // the curve is shared by the channels, only the scale differs
+    for (uint32_t base = 0; base < size; base += RAMP_LANES) {
+        const auto X     = (index + (float)base) * STEP;
+        const auto CURVE = LINEAR ? X : select(X > 0.f, exp2v(exponent * log2v(X)), vfloat{});
+        const auto LEFT  = std::min<uint32_t>(RAMP_LANES, size - base);
+
+        for (size_t c = 0; c < 3; ++c) {
+            auto v = CURVE * (scale[c] * 65535.f) + 0.5f;
+            v      = select(v > 65535.f, vfloat{} + 65535.f, select(v < 0.f, vfloat{}, v));
+
+            // through int32, float to uint16 directly isn't a vector instruction anywhere. a constant size is a single store, only the last block
+            // of an odd size takes the slow one
+            const auto OUT = __builtin_convertvector(__builtin_convertvector(v, vint), vu16);
+            if (LEFT == RAMP_LANES)
+                std::memcpy(table + c * size + base, &OUT, sizeof(OUT));
+            else
+                std::memcpy(table + c * size + base, &OUT, LEFT * sizeof(uint16_t));
+        }
+    }
+}
+
+CGammaRamp::CGammaRamp(uint32_t size) : m_iSize(size), m_iBytes((size_t)size * 3 * sizeof(uint16_t)) {
+    // the size comes from the compositor, a bogus one mustn't take us down
+    if (size > 0)
+        m_pTable.reset(new (std::nothrow) uint16_t[(size_t)size * 3]);
+}
+
+bool CGammaRamp::valid() const {
+    return m_pTable != nullptr;
+}
+
+uint32_t CGammaRamp::size() const {
+    return m_iSize;
+}
+
+void CGammaRamp::fill(const std::array<float, 3>& scale, float exponent) {
+    if (m_pTable)
+        GammaRamp::fill(m_pTable.get(), m_iSize, scale, exponent);
+}
+
+int CGammaRamp::exportFD() const {
+    if (!m_pTable)
+        return -1;
+
+    const int FD = memfd_create("hyprsunset-gamma", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (FD < 0)
+        return -1;
+
+    // pwrite leaves the offset at 0, where compositors start to read() from
+    const auto DATA = (const char*)m_pTable.get();
+    for (size_t written = 0; written < m_iBytes;) {
+        const auto LEN = pwrite(FD, DATA + written, m_iBytes - written, written);
+        if (LEN < 0 && errno == EINTR)
+            continue;
+
+        if (LEN <= 0) {
+            close(FD);
+            return -1;
+        }
+
+        written += LEN;
+    }
+
+    // nothing can change it anymore, whenever the compositor gets to it
+    fcntl(FD, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+
+    return FD;
+}
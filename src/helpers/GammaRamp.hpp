@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Gamma tables in the wlr-gamma-control layout: size 16 bit entries of red, then green, then blue.
+namespace GammaRamp {
+    // scale is the per-channel factor (a ctm's diagonal), every entry is scale * x^exponent for x in [0, 1]. vectorized, the whole table is a
+    // few microseconds
+    void fill(uint16_t* table, uint32_t size, const std::array<float, 3>& scale, float exponent);
+}
+
+// A table kept in memory, every update goes out in a sealed memfd of its own. the compositor may read a set_gamma's fd long after it was
+// sent, a single memfd rewritten in place could hand it half of the next table
+class CGammaRamp {
+  public:
+    CGammaRamp(uint32_t size);
+
+    // false if the table couldn't be allocated
+    bool     valid() const;
+    uint32_t size() const;
+
+    void     fill(const std::array<float, 3>& scale, float exponent);
+    // a new memfd holding the table at offset 0, sealed against writes, for set_gamma. the caller closes it
+    int exportFD() const;
+
+  private:
+    std::unique_ptr<uint16_t[]> m_pTable;
+    uint32_t                    m_iSize  = 0;
+    size_t                      m_iBytes = 0;
+};
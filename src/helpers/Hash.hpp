@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// FNV-1a, for noticing that something changed. Nothing adversarial goes through it
+namespace Hash {
+    inline constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+    inline constexpr uint64_t FNV_PRIME  = 0x100000001b3ULL;
+
+    // chain calls by passing the previous result as hash
+    constexpr uint64_t fnv1a(std::string_view data, uint64_t hash = FNV_OFFSET) {
+        for (const unsigned char c : data) {
+            hash ^= c;
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Per-channel multipliers for a color temperature, baked at compile time so a lookup is a lerp between two table entries.
+
+enum eKelvinModel : uint8_t {
+    KELVIN_MODEL_APPROXIMATE = 0, // tanner helland's curve fit, what hyprsunset always used
+    KELVIN_MODEL_PLANCKIAN,       // blackbody chromaticity (krystek) converted to sRGB, white balanced to D65
+};
+
+namespace Kelvin {
+    inline constexpr unsigned long long MIN  = 1000;
+    inline constexpr unsigned long long MAX  = 20000;
+    inline constexpr unsigned long long STEP = 10;
+    inline constexpr size_t             SIZE = (MAX - MIN) / STEP + 1;
+
+    struct SRGB {
+        float r = 1.F, g = 1.F, b = 1.F;
+    };
+
+    using Table = std::array<SRGB, SIZE>;
+
+    // <cmath> isn't usable in constant expressions everywhere yet, these are plenty for baking
+    namespace Math {
+        inline constexpr double LN2 = 0.69314718055994530942;
+
+        constexpr double exp(double x) {
+            int k = (int)(x / LN2 + (x >= 0 ? 0.5 : -0.5));
+
+            // e^x = 2^k * e^r, |r| <= ln2 / 2
+            double r = x - k * LN2, term = 1, sum = 1;
+            for (int i = 1; i < 30; ++i) {
+                term *= r / i;
+                sum += term;
+            }
+
+            for (; k > 0; --k) {
+                sum *= 2;
+            }
+            for (; k < 0; ++k) {
+                sum /= 2;
+            }
+
+            return sum;
+        }
+
+        constexpr double log(double x) {
+            int k = 0;
+            for (; x >= 2; ++k) {
+                x /= 2;
+            }
+            for (; x < 1; --k) {
+                x *= 2;
+            }
+
+            // ln(x) = 2 atanh((x - 1) / (x + 1)), x in [1, 2)
+            const double Y = (x - 1) / (x + 1), Y2 = Y * Y;
+            double       term = Y, sum = 0;
+            for (int i = 1; i < 60; i += 2) {
+                sum += term / i;
+                term *= Y2;
+            }
+
+            return 2 * sum + k * LN2;
+        }
+
+        constexpr double pow(double base, double exponent) {
+            return base <= 0 ? 0 : exp(exponent * log(base));
+        }
+    }
+
+    // kindly borrowed from https://tannerhelland.com/2012/09/18/convert-temperature-rgb-algorithm-code.html
+    constexpr SRGB approximate(double kelvin) {
+        const double TEMP = kelvin / 100.0;
+        double       r = 255, g = 255, b = 255;
+
+        if (TEMP <= 66) {
+            g = std::clamp(99.4708025861 * Math::log(TEMP) - 161.1195681661, 0.0, 255.0);
+            b = TEMP <= 19 ? 0 : std::clamp(Math::log(TEMP - 10) * 138.5177312231 - 305.0447927307, 0.0, 255.0);
+        } else {
+            r = std::clamp(329.698727446 * Math::pow(TEMP - 60, -0.1332047592), 0.0, 255.0);
+            g = std::clamp(288.1221695283 * Math::pow(TEMP - 60, -0.0755148492), 0.0, 255.0);
+        }
+
+        return {(float)(r / 255.0), (float)(g / 255.0), (float)(b / 255.0)};
+    }
+
+    // linear sRGB of the planckian locus at a temperature, for Y = 1
+    constexpr std::array<double, 3> planckianLinear(double kelvin) {
+        // krystek's rational approximation of the locus in CIE 1960 uv
+        const double T  = kelvin;
+        const double U  = (0.860117757 + 1.54118254e-4 * T + 1.28641212e-7 * T * T) / (1 + 8.42420235e-4 * T + 7.08145163e-7 * T * T);
+        const double V  = (0.317398726 + 4.22806245e-5 * T + 4.20481691e-8 * T * T) / (1 - 2.89741816e-5 * T + 1.61456053e-7 * T * T);
+
+        const double D  = 2 * U - 8 * V + 4;
+        const double X  = 3 * U / D;
+        const double Y  = 2 * V / D;
+
+        const double CX = X / Y, CZ = (1 - X - Y) / Y;
+
+        return {
+            3.2404542 * CX - 1.5371385 - 0.4985314 * CZ,
+            -0.9692660 * CX + 1.8760108 + 0.0415560 * CZ,
+            0.0556434 * CX - 0.2040259 + 1.0572252 * CZ,
+        };
+    }
+
+    constexpr SRGB planckian(double kelvin) {
+        const auto WHITE = planckianLinear(6504);
+        auto       rgb   = planckianLinear(kelvin);
+
+        double     max = 0;
+        for (size_t i = 0; i < 3; ++i) {
+            rgb[i] = std::max(rgb[i] / WHITE[i], 0.0);
+            max    = std::max(max, rgb[i]);
+        }
+
+        std::array<float, 3> encoded;
+        for (size_t i = 0; i < 3; ++i) {
+            const double C = rgb[i] / max;
+            encoded[i]     = (float)(C <= 0.0031308 ? 12.92 * C : 1.055 * Math::pow(C, 1.0 / 2.4) - 0.055);
+        }
+
+        return {encoded[0], encoded[1], encoded[2]};
+    }
+
+    template <typename Fn>
+    consteval Table bake(Fn fn) {
+        Table table;
+        for (size_t i = 0; i < SIZE; ++i) {
+            table[i] = fn((double)(MIN + i * STEP));
+        }
+        return table;
+    }
+
+    inline constexpr Table APPROXIMATE_TABLE = bake(approximate);
+    inline constexpr Table PLANCKIAN_TABLE   = bake(planckian);
+
+    constexpr SRGB lookup(double kelvin, eKelvinModel model = KELVIN_MODEL_APPROXIMATE) {
+        const auto&  TABLE = model == KELVIN_MODEL_PLANCKIAN ? PLANCKIAN_TABLE : APPROXIMATE_TABLE;
+
+        const double POS  = (std::clamp(kelvin, (double)MIN, (double)MAX) - MIN) / STEP;
+        const size_t IDX  = std::min((size_t)POS, SIZE - 2);
+        const float  FRAC = (float)(POS - IDX);
+
+        const auto&  A = TABLE[IDX];
+        const auto&  B = TABLE[IDX + 1];
+
+        return {A.r + (B.r - A.r) * FRAC, A.g + (B.g - A.g) * FRAC, A.b + (B.b - A.b) * FRAC};
+    }
+}
@@ -0,0 +1,163 @@
+#include "Log.hpp"
+
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+// A bounded multi-producer queue (the per-slot sequence scheme from Vyukov's MPMC queue) with a single consumer, the writer thread.
+// A slot is free for position p when its sequence is p, filled when it's p + 1, and handed back for the next lap as p + RING_SLOTS.
+struct SLogRing {
+    std::array<Debug::SLogSlot, Debug::RING_SLOTS> slots;
+
+    // producers and the writer each hammer one of these, keep them off each other's cache line
+    alignas(64) std::atomic<uint64_t> head = 0; // next position a producer claims
+    alignas(64) std::atomic<uint64_t> tail = 0; // everything before it has been written out
+
+    std::atomic<uint64_t>             drops    = 0;
+    std::atomic<uint32_t>             wakeups  = 0;
+    std::atomic<bool>                 stopping = false; // the writer exits once it's drained the ring
+    std::atomic<bool>                 drained  = false; // it did, producers write directly from now on
+    std::thread                       writer;
+
+    SLogRing() {
+        for (size_t i = 0; i < slots.size(); ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+static void writeAll(std::string_view data) {
+    while (!data.empty()) {
+        const auto LEN = write(Debug::outputFD, data.data(), data.size());
+        if (LEN < 0 && errno == EINTR)
+            continue;
+        if (LEN <= 0)
+            return;
+
+        data.remove_prefix(LEN);
+    }
+}
+
+static void runWriter(SLogRing* ring) {
+    std::string batch;
+    uint64_t    reportedDrops = 0;
+
+    while (true) {
+        const auto WAKEUPS = ring->wakeups.load(std::memory_order_acquire);
+        auto       pos     = ring->tail.load(std::memory_order_relaxed);
+        const auto BEGIN   = pos;
+
+        batch.clear();
+
+        // everything published in order, up to the first slot that's claimed but not filled yet
+        while (true) {
+            auto& slot = ring->slots[pos % Debug::RING_SLOTS];
+            if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+                break;
+
+            batch.append(slot.data, slot.length);
+            slot.sequence.store(pos + Debug::RING_SLOTS, std::memory_order_release);
+            ++pos;
+        }
+
+        if (const auto DROPS = ring->drops.load(std::memory_order_relaxed); DROPS != reportedDrops) {
+            batch += std::format("[WARN] Log buffer full, dropped {} lines\n", DROPS - reportedDrops);
+            reportedDrops = DROPS;
+        }
+
+        // one write per wakeup, however many lines came in
+        writeAll(batch);
+
+        if (pos != BEGIN) {
+            ring->tail.store(pos, std::memory_order_release);
+            ring->tail.notify_all();
+            continue;
+        }
+
+        if (ring->stopping.load(std::memory_order_acquire))
+            return;
+
+        ring->wakeups.wait(WAKEUPS, std::memory_order_acquire);
+    }
+}
+
+// leaked on purpose, objects destroyed at exit may still log. the exit handler drains it and switches to writing synchronously
+static SLogRing& ring() {
+    static SLogRing* instance = [] {
+        const auto RING = new SLogRing;
+        RING->writer    = std::thread(runWriter, RING);
+
+        std::atexit([] {
+            auto& r = ring();
+            r.stopping.store(true, std::memory_order_release);
+            r.wakeups.fetch_add(1, std::memory_order_release);
+            r.wakeups.notify_one();
+            r.writer.join();
+            r.drained.store(true, std::memory_order_release);
+        });
+
+        return RING;
+    }();
+
+    return *instance;
+}
+
+Debug::SLogSlot* Debug::acquire(uint64_t& position) {
+    auto& r   = ring();
+    auto  pos = r.head.load(std::memory_order_relaxed);
+
+    while (true) {
+        auto&      slot = r.slots[pos % RING_SLOTS];
+        const auto DIFF = (int64_t)(slot.sequence.load(std::memory_order_acquire) - pos);
+
+        if (DIFF == 0) {
+            if (r.head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                position = pos;
+                return &slot;
+            }
+        } else if (DIFF < 0) {
+            // still holding last lap's line
+            r.drops.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else
+            pos = r.head.load(std::memory_order_relaxed);
+    }
+}
+
+void Debug::publish(SLogSlot* slot, uint64_t position) {
+    auto& r = ring();
+
+    slot->sequence.store(position + 1, std::memory_order_release);
+
+    // nobody's draining anymore, write it here
+    if (r.drained.load(std::memory_order_acquire)) {
+        writeAll({slot->data, slot->length});
+        slot->sequence.store(position + RING_SLOTS, std::memory_order_release);
+        r.tail.store(position + 1, std::memory_order_release);
+        return;
+    }
+
+    r.wakeups.fetch_add(1, std::memory_order_release);
+    r.wakeups.notify_one();
+}
+
+void Debug::writeNow(std::string_view line) {
+    auto&      r      = ring();
+    const auto TARGET = r.head.load(std::memory_order_acquire);
+
+    // keeps the order with what's already queued
+    for (auto tail = r.tail.load(std::memory_order_acquire); tail < TARGET && !r.drained.load(std::memory_order_acquire); tail = r.tail.load(std::memory_order_acquire)) {
+        r.wakeups.fetch_add(1, std::memory_order_release);
+        r.wakeups.notify_one();
+        r.tail.wait(tail, std::memory_order_acquire);
+    }
+
+    writeAll(line);
+}
+
+uint64_t Debug::dropped() {
+    return ring().drops.load(std::memory_order_relaxed);
+}
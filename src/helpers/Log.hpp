@@ -1,9 +1,12 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
 #include <format>
-#include <fstream>
 #include <string>
-#include <iostream>
+#include <string_view>
 
 enum LogLevel {
     NONE = -1,
@@ -15,32 +18,114 @@ enum LogLevel {
     TRACE
 };
 
+// least severe level that's compiled in at all, see Debug::severity. set by the build (HYPRSUNSET_LOG_LEVEL with cmake, log_level with meson)
+#ifndef HYPRSUNSET_MIN_LOG_SEVERITY
+#define HYPRSUNSET_MIN_LOG_SEVERITY 0
+#endif
+
 #define RASSERT(expr, reason, ...)                                                                                                                                                 \
     if (!(expr)) {                                                                                                                                                                 \
-        Debug::log(CRIT, "\n==========================================================================================\nASSERTION FAILED! \n\n{}\n\nat: line {} in {}",            \
-                   std::format(reason, ##__VA_ARGS__), __LINE__,                                                                                                                   \
-                   ([]() constexpr -> std::string { return std::string(__FILE__).substr(std::string(__FILE__).find_last_of('/') + 1); })().c_str());                               \
+        Debug::log<CRIT>("\n==========================================================================================\nASSERTION FAILED! \n\n{}\n\nat: line {} in {}",            \
+                         std::format(reason, ##__VA_ARGS__), __LINE__,                                                                                                             \
+                         ([]() constexpr -> std::string { return std::string(__FILE__).substr(std::string(__FILE__).find_last_of('/') + 1); })().c_str());                         \
         std::abort();                                                                                                                                                              \
     }
 
+// Lines are formatted by the caller into a lock-free ring and written out by a background thread, so a slow stdout (a journald pipe) never blocks
+// the event loop. A full ring drops lines and counts them, CRIT is written synchronously since an abort usually follows.
 namespace Debug {
     inline bool trace = false;
 
+    // where the writer puts lines, only change it before the first log
+    inline int              outputFD = 1;
+
+    inline constexpr size_t RING_SLOTS = 256;
+    inline constexpr size_t SLOT_SIZE  = 1024; // longer lines skip the ring and are written synchronously
+
+    struct SLogSlot {
+        std::atomic<uint64_t> sequence = 0;
+        uint32_t              length   = 0;
+        char                  data[SLOT_SIZE];
+    };
+
+    // claims the next slot, nullptr (and a dropped line) if the writer hasn't caught up
+    SLogSlot* acquire(uint64_t& position);
+    // hands a filled slot to the writer
+    void publish(SLogSlot* slot, uint64_t position);
+    // waits for everything queued so far, then writes line directly
+    void writeNow(std::string_view line);
+    // lines lost to a full ring since start
+    uint64_t dropped();
+
+    // independent of the enum's order. NONE is what the user is meant to see, it's never compiled out
+    constexpr int severity(LogLevel level) {
+        switch (level) {
+            case TRACE: return 0;
+            case LOG:
+            case INFO: return 1;
+            case WARN: return 2;
+            case ERR: return 3;
+            case CRIT:
+            case NONE: return 4;
+        }
+
+        return 4;
+    }
+
+    constexpr std::string_view prefix(LogLevel level) {
+        switch (level) {
+            case NONE: return "";
+            case LOG: return "[LOG] ";
+            case WARN: return "[WARN] ";
+            case ERR: return "[ERR] ";
+            case CRIT: return "[CRIT] ";
+            case INFO: return "[INFO] ";
+            case TRACE: return "[TRACE] ";
+        }
+
+        return "";
+    }
+
+    // formats and queues a line, the level check is log's
     template <typename... Args>
-    void log(LogLevel level, std::format_string<Args...> fmt, Args&&... args) {
-        if (!trace && (level == LOG || level == INFO))
+    void write(LogLevel level, std::format_string<Args...> fmt, Args&&... args) {
+        // --verbose, the rest always goes out
+        if (!trace && (level == LOG || level == INFO || level == TRACE))
             return;
 
-        switch (level) {
-            case NONE: break;
-            case LOG: std::cout << "[LOG] "; break;
-            case WARN: std::cout << "[WARN] "; break;
-            case ERR: std::cout << "[ERR] "; break;
-            case CRIT: std::cout << "[CRIT] "; break;
-            case INFO: std::cout << "[INFO] "; break;
-            case TRACE: std::cout << "[TRACE] "; break;
+        const auto PREFIX = prefix(level);
+
+        if (level == CRIT) {
+            writeNow(std::format("{}{}\n", PREFIX, std::format(fmt, std::forward<Args>(args)...)));
+            return;
         }
 
-        std::cout << std::vformat(fmt.get(), std::make_format_args(args...)) << std::endl; // flush cuz systemd etc
+        uint64_t   position = 0;
+        const auto SLOT     = acquire(position);
+        if (!SLOT)
+            return;
+
+        auto       out    = std::copy(PREFIX.begin(), PREFIX.end(), SLOT->data);
+        const auto RESULT = std::format_to_n(out, SLOT_SIZE - PREFIX.size() - 1, fmt, std::forward<Args>(args)...);
+
+        if ((size_t)RESULT.size > SLOT_SIZE - PREFIX.size() - 1) {
+            // give the slot back empty, it has to be out of the way before writeNow can go
+            SLOT->length = 0;
+            publish(SLOT, position);
+            writeNow(std::format("{}{}\n", PREFIX, std::format(fmt, std::forward<Args>(args)...)));
+            return;
+        }
+
+        out          = RESULT.out;
+        *out++       = '\n';
+        SLOT->length = out - SLOT->data;
+        publish(SLOT, position);
+    }
+
+    // levels below HYPRSUNSET_MIN_LOG_SEVERITY don't instantiate write, nothing of the call is left but side effects of its arguments
+    template <LogLevel LEVEL, typename... Args>
+    void log(std::format_string<Args...> fmt, Args&&... args) {
+        if constexpr (severity(LEVEL) >= HYPRSUNSET_MIN_LOG_SEVERITY)
+            write(LEVEL, fmt, std::forward<Args>(args)...);
     }
 }; // namespace Debug
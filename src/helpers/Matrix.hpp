@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Kelvin.hpp"
+
+#include <array>
+#include <wayland-util.h>
+
+#include <hyprutils/math/Mat3x3.hpp>
+using namespace Hyprutils::Math;
+
+// Building the CTMs, free of any daemon state.
+
+inline Mat3x3 matrixForKelvin(unsigned long long temp, eKelvinModel model) {
+    const auto RGB = Kelvin::lookup(temp, model);
+
+    return std::array<float, 9>{RGB.r, 0, 0, 0, RGB.g, 0, 0, 0, RGB.b};
+}
+
+inline Mat3x3 buildMatrix(unsigned long long kelvin, float gamma, bool identity, eKelvinModel model) {
+    auto ctm = identity ? Mat3x3::identity() : matrixForKelvin(kelvin, model);
+    ctm.multiply(std::array<float, 9>{gamma, 0, 0, 0, gamma, 0, 0, 0, gamma});
+
+    return ctm;
+}
+
+// what the compositor will actually see, two matrices with equal fixed values look the same on screen
+inline std::array<wl_fixed_t, 9> fixedFromMatrix(const Mat3x3& mat) {
+    const auto                ARR = mat.getMatrix();
+    std::array<wl_fixed_t, 9> result;
+
+    for (size_t i = 0; i < ARR.size(); ++i) {
+        result[i] = wl_fixed_from_double(ARR[i]);
+    }
+
+    return result;
+}
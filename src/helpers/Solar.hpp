@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <optional>
+#include <string_view>
+
+// Sunrise, sunset and civil twilight from NOAA's general solar position equations, good to a minute or two away from the poles.
+
+enum eSolarEvent : uint8_t {
+    SOLAR_EVENT_NONE = 0,
+    SOLAR_EVENT_DAWN, // civil, sun 6° below the horizon
+    SOLAR_EVENT_SUNRISE,
+    SOLAR_EVENT_SUNSET,
+    SOLAR_EVENT_DUSK,
+};
+
+struct SLocation {
+    double latitude  = 0; // degrees, north positive
+    double longitude = 0; // degrees, east positive
+
+    bool   operator==(const SLocation&) const = default;
+};
+
+namespace Solar {
+    constexpr std::string_view eventName(eSolarEvent event) {
+        switch (event) {
+            case SOLAR_EVENT_DAWN: return "dawn";
+            case SOLAR_EVENT_SUNRISE: return "sunrise";
+            case SOLAR_EVENT_SUNSET: return "sunset";
+            case SOLAR_EVENT_DUSK: return "dusk";
+            default: break;
+        }
+
+        return "";
+    }
+
+    constexpr eSolarEvent eventFromName(std::string_view name) {
+        for (const auto EVENT : {SOLAR_EVENT_DAWN, SOLAR_EVENT_SUNRISE, SOLAR_EVENT_SUNSET, SOLAR_EVENT_DUSK}) {
+            if (eventName(EVENT) == name)
+                return EVENT;
+        }
+
+        return SOLAR_EVENT_NONE;
+    }
+
+    // when the event happens on date (a calendar date at the location), nullopt if it doesn't (polar day / night)
+    inline std::optional<std::chrono::sys_seconds> eventOn(std::chrono::year_month_day date, const SLocation& location, eSolarEvent event) {
+        constexpr double DEG = std::numbers::pi / 180.0;
+
+        const auto       DAYS  = std::chrono::sys_days{date};
+        const auto       YEAR  = std::chrono::sys_days{date.year() / std::chrono::January / 1};
+        const double     YDAYS = date.year().is_leap() ? 366 : 365;
+
+        // fractional year at noon, radians
+        const double G = 2 * std::numbers::pi / YDAYS * (DAYS - YEAR).count();
+
+        // minutes
+        const double EQTIME = 229.18 * (0.000075 + 0.001868 * std::cos(G) - 0.032077 * std::sin(G) - 0.014615 * std::cos(2 * G) - 0.040849 * std::sin(2 * G));
+        // radians
+        const double DECL = 0.006918 - 0.399912 * std::cos(G) + 0.070257 * std::sin(G) - 0.006758 * std::cos(2 * G) + 0.000907 * std::sin(2 * G) - 0.002697 * std::cos(3 * G) +
+            0.00148 * std::sin(3 * G);
+
+        // sunrise / sunset account for refraction and the sun's radius
+        const double ZENITH = (event == SOLAR_EVENT_DAWN || event == SOLAR_EVENT_DUSK ? 96.0 : 90.833) * DEG;
+        const double LAT    = location.latitude * DEG;
+        const double COSHA  = std::cos(ZENITH) / (std::cos(LAT) * std::cos(DECL)) - std::tan(LAT) * std::tan(DECL);
+
+        if (event == SOLAR_EVENT_NONE || COSHA < -1 || COSHA > 1)
+            return std::nullopt;
+
+        const double HA      = std::acos(COSHA) / DEG;
+        const bool   MORNING = event == SOLAR_EVENT_DAWN || event == SOLAR_EVENT_SUNRISE;
+
+        // minutes from utc midnight of date, may fall outside the day far from greenwich
+        const double MINUTES = 720 - 4 * (location.longitude + (MORNING ? HA : -HA)) - EQTIME;
+
+        return std::chrono::floor<std::chrono::seconds>(DAYS + std::chrono::duration<double, std::ratio<60>>(MINUTES));
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+
+// Counters and latency histograms for the stats IPC command. Everything is fixed size, recording never allocates.
+
+enum eStatCounter : uint8_t {
+    STAT_RELOADS = 0,
+    STAT_COMMITS_SENT,
+    STAT_COMMITS_SKIPPED, // a reload or transition step that left every output as it was
+    STAT_SCHEDULE_WAKEUPS,
+    STAT_OUTPUTS_ADDED,
+    STAT_OUTPUTS_REMOVED,
+    STAT_COUNTER_COUNT,
+};
+
+enum eStatHistogram : uint8_t {
+    STAT_REQUEST_TO_COMMIT = 0, // an ipc request that changed something was read → sendCommit
+    STAT_FLUSH,                 // wl_display_flush right after a commit
+    STAT_COMMIT_ACK,            // sendCommit → the wl_display_sync callback sent after it is done
+    STAT_HISTOGRAM_COUNT,
+};
+
+namespace Stats {
+    using clock = std::chrono::steady_clock;
+
+    // bucket i holds [2^(i-1), 2^i) microseconds, the first one less than a microsecond and the last one everything above
+    inline constexpr size_t BUCKETS = 32;
+
+    struct SHistogram {
+        std::array<uint64_t, BUCKETS> buckets = {};
+        uint64_t                      count   = 0;
+        uint64_t                      sum     = 0; // µs
+        uint64_t                      min     = std::numeric_limits<uint64_t>::max();
+        uint64_t                      max     = 0;
+
+        void                          record(clock::duration duration) {
+            const uint64_t US = std::max<int64_t>(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), 0);
+
+            buckets[std::min<size_t>(std::bit_width(US), BUCKETS - 1)]++;
+            count++;
+            sum += US;
+            min = std::min(min, US);
+            max = std::max(max, US);
+        }
+
+        // upper bound of the bucket holding the quantile, clamped to the largest value seen
+        uint64_t quantile(double q) const {
+            if (count == 0)
+                return 0;
+
+            const auto RANK = (uint64_t)(q * (count - 1)) + 1;
+            uint64_t   seen = 0;
+
+            for (size_t i = 0; i < BUCKETS; ++i) {
+                seen += buckets[i];
+                if (seen >= RANK)
+                    return std::min<uint64_t>(1ULL << i, max);
+            }
+
+            return max;
+        }
+    };
+
+    inline const clock::time_point                      start = clock::now();
+    inline std::array<uint64_t, STAT_COUNTER_COUNT>     counters;
+    inline std::array<SHistogram, STAT_HISTOGRAM_COUNT> histograms;
+
+    // oldest ipc change that hasn't made it into a commit yet, later ones in the same reload don't restart it
+    inline std::optional<clock::time_point> pendingRequest;
+
+    inline void count(eStatCounter counter) {
+        counters[counter]++;
+    }
+
+    inline void record(eStatHistogram histogram, clock::duration duration) {
+        histograms[histogram].record(duration);
+    }
+
+    inline void requestReceived(clock::time_point at) {
+        if (!pendingRequest)
+            pendingRequest = at;
+    }
+
+    constexpr std::string_view counterName(eStatCounter counter) {
+        switch (counter) {
+            case STAT_RELOADS: return "reloads";
+            case STAT_COMMITS_SENT: return "commits_sent";
+            case STAT_COMMITS_SKIPPED: return "commits_skipped";
+            case STAT_SCHEDULE_WAKEUPS: return "schedule_wakeups";
+            case STAT_OUTPUTS_ADDED: return "outputs_added";
+            case STAT_OUTPUTS_REMOVED: return "outputs_removed";
+            default: break;
+        }
+
+        return "unknown";
+    }
+
+    constexpr std::string_view histogramName(eStatHistogram histogram) {
+        switch (histogram) {
+            case STAT_REQUEST_TO_COMMIT: return "request_to_commit";
+            case STAT_FLUSH: return "flush";
+            case STAT_COMMIT_ACK: return "commit_ack";
+            default: break;
+        }
+
+        return "unknown";
+    }
+}
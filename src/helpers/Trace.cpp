@@ -0,0 +1,177 @@
+#include "Trace.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// events a thread collects before handing them to the writer
+#define TRACE_BUFFER_EVENTS 4096
+
+struct STraceEvent {
+    const char* name  = nullptr;
+    int64_t     begin = 0; // ns since open()
+    int64_t     dur   = 0; // ns
+    char        phase = 'X';
+};
+
+static std::FILE*                                                 file = nullptr;
+static Trace::clock::time_point                                   origin;
+static std::atomic<uint32_t>                                      nextTid = 1;
+
+static std::mutex                                                 queueMutex;
+static std::condition_variable                                    queueSignal;
+static std::vector<std::pair<uint32_t, std::vector<STraceEvent>>> queue;
+static bool                                                       stopping = false;
+static std::thread                                                writer;
+
+static int64_t sinceOrigin(Trace::clock::time_point at) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(at - origin).count();
+}
+
+static void runWriter() {
+    const auto PID   = getpid();
+    bool       first = true;
+
+    while (true) {
+        std::vector<std::pair<uint32_t, std::vector<STraceEvent>>> batch;
+
+        {
+            std::unique_lock lock(queueMutex);
+            queueSignal.wait(lock, [] { return stopping || !queue.empty(); });
+
+            if (queue.empty() && stopping)
+                return;
+
+            batch.swap(queue);
+        }
+
+        for (const auto& [tid, events] : batch) {
+            for (const auto& e : events) {
+                // microseconds, keeping the nanoseconds as decimals
+                std::fprintf(file, R"(%s{"name":"%s","ph":"%c","ts":%lld.%03lld,"pid":%d,"tid":%u)", first ? "" : ",\n", e.name, e.phase, (long long)(e.begin / 1000),
+                             (long long)(e.begin % 1000), PID, tid);
+
+                if (e.phase == 'X')
+                    std::fprintf(file, R"(,"dur":%lld.%03lld})", (long long)(e.dur / 1000), (long long)(e.dur % 1000));
+                else
+                    std::fprintf(file, R"(,"s":"t"})");
+
+                first = false;
+            }
+        }
+
+        std::fflush(file);
+    }
+}
+
+struct SThreadBuffer {
+    uint32_t                 tid = nextTid++;
+    std::vector<STraceEvent> events;
+
+    // refill = false from the destructor, the buffer isn't used again
+    void                     submit(bool refill = true) {
+        if (events.empty())
+            return;
+
+        {
+            std::lock_guard lg(queueMutex);
+            // closed already, nobody would write these
+            if (!file || stopping) {
+                events.clear();
+                return;
+            }
+
+            queue.emplace_back(tid, std::move(events));
+        }
+
+        queueSignal.notify_one();
+        events = {};
+
+        if (refill)
+            events.reserve(TRACE_BUFFER_EVENTS);
+    }
+
+    ~SThreadBuffer();
+};
+
+static thread_local SThreadBuffer buffer;
+// set once this thread's buffer is destroyed, a close() after that must not touch it
+static thread_local bool bufferGone = false;
+
+SThreadBuffer::~SThreadBuffer() {
+    submit(false);
+    bufferGone = true;
+}
+
+// exit() from somewhere other than main (a protocol error) skips main's close(). destroyed before writer, which must not be joinable then
+static struct SCloseAtExit {
+    ~SCloseAtExit() {
+        Trace::close();
+    }
+} closeAtExit;
+
+static void push(const STraceEvent& event) {
+    buffer.events.emplace_back(event);
+
+    if (buffer.events.size() >= TRACE_BUFFER_EVENTS)
+        buffer.submit();
+}
+
+bool Trace::open(const std::string& path) {
+    file = std::fopen(path.c_str(), "we");
+    if (!file)
+        return false;
+
+    std::fputs("[\n", file);
+
+    origin  = clock::now();
+    writer  = std::thread(runWriter);
+    enabled = true;
+
+    buffer.events.reserve(TRACE_BUFFER_EVENTS);
+
+    return true;
+}
+
+void Trace::close() {
+    if (!enabled)
+        return;
+
+    enabled = false;
+    if (!bufferGone)
+        buffer.submit(false);
+
+    {
+        std::lock_guard lg(queueMutex);
+        stopping = true;
+    }
+
+    queueSignal.notify_one();
+    writer.join();
+
+    // the closing bracket is optional in the array format, a trace cut short by a crash still loads
+    std::fputs("\n]\n", file);
+    std::fclose(file);
+    file = nullptr;
+}
+
+void Trace::complete(const char* name, clock::time_point begin) {
+    if (!enabled)
+        return;
+
+    const auto BEGIN = sinceOrigin(begin);
+    push(STraceEvent{.name = name, .begin = BEGIN, .dur = sinceOrigin(clock::now()) - BEGIN, .phase = 'X'});
+}
+
+void Trace::instant(const char* name) {
+    if (!enabled)
+        return;
+
+    push(STraceEvent{.name = name, .begin = sinceOrigin(clock::now()), .phase = 'i'});
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+// Chrome trace-event json for --trace-file, opens in chrome://tracing or ui.perfetto.dev. Events are appended to a buffer per thread, full
+// buffers are written out by a background thread. With no trace file a scope is a branch on a bool.
+namespace Trace {
+    using clock = std::chrono::steady_clock;
+
+    inline bool enabled = false;
+
+    // call before anything is traced, timestamps count from here
+    bool open(const std::string& path);
+    // writes out whatever is buffered and closes the file. main calls it before returning, while its thread's buffer is still alive
+    void close();
+
+    // name has to outlive the trace, a literal
+    void complete(const char* name, clock::time_point begin);
+    void instant(const char* name);
+
+    class CScope {
+      public:
+        CScope(const char* name) : m_name(name), m_bActive(enabled) {
+            if (m_bActive)
+                m_begin = clock::now();
+        }
+
+        ~CScope() {
+            if (m_bActive)
+                complete(m_name, m_begin);
+        }
+
+      private:
+        const char*       m_name    = nullptr;
+        bool              m_bActive = false;
+        clock::time_point m_begin;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b)       TRACE_CONCAT_INNER(a, b)
+// a span from here to the end of the enclosing block
+#define TRACE_SCOPE(name) const Trace::CScope TRACE_CONCAT(traceScope, __LINE__){name}
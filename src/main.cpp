@@ -1,19 +1,52 @@
 #include "ConfigManager.hpp"
+#include "src/helpers/Hash.hpp"
 #include "src/helpers/Log.hpp"
+#include "src/helpers/Trace.hpp"
+#include "src/backend/IOutputBackend.hpp"
+
+#include <cstdio>
+#include <unistd.h>
+
+// YYYY-MM-DD or YYYY-MM-DDTHH:MM, local to zone. a time inside a DST gap is the moment the gap starts
+static std::optional<std::chrono::sys_seconds> parseLocalTime(const std::string& str, const std::chrono::time_zone* zone) {
+    int      year = 0, length = 0, timeLength = 0;
+    unsigned month = 0, day = 0, hour = 0, minute = 0;
+
+    if (sscanf(str.c_str(), "%d-%u-%u%n", &year, &month, &day, &length) != 3)
+        return std::nullopt;
+
+    if ((size_t)length != str.size() && (sscanf(str.c_str() + length, "T%u:%u%n", &hour, &minute, &timeLength) != 2 || (size_t)(length + timeLength) != str.size()))
+        return std::nullopt;
+
+    const auto DATE = std::chrono::year{year} / std::chrono::month{month} / std::chrono::day{day};
+    if (!DATE.ok() || hour > 23 || minute > 59)
+        return std::nullopt;
+
+    const auto LOCAL = std::chrono::local_days{DATE} + std::chrono::hours{hour} + std::chrono::minutes{minute};
+    return std::chrono::floor<std::chrono::seconds>(zone->to_sys(LOCAL, std::chrono::choose::earliest));
+}
 
 static void printHelp() {
-    Debug::log(NONE, "┣ --gamma             -g  →  Set the display gamma (default 100%)");
-    Debug::log(NONE, "┣ --gamma_max             →  Set the maximum display gamma (default 100%, maximum 200%)");
-    Debug::log(NONE, "┣ --temperature       -t  →  Set the temperature in K (default 6000)");
-    Debug::log(NONE, "┣ --identity          -i  →  Use the identity matrix (no color change)");
-    Debug::log(NONE, "┣ --verbose               →  Print more logging");
-    Debug::log(NONE, "┣ --version           -v  →  Print the version");
-    Debug::log(NONE, "┣ --help              -h  →  Print this info");
-    Debug::log(NONE, "╹");
+    Debug::log<NONE>("┣ --gamma             -g  →  Set the display gamma (default 100%)");
+    Debug::log<NONE>("┣ --gamma_max             →  Set the maximum display gamma (default 100%, maximum 200%)");
+    Debug::log<NONE>("┣ --temperature       -t  →  Set the temperature in K (default 6000)");
+    Debug::log<NONE>("┣ --identity          -i  →  Use the identity matrix (no color change)");
+    Debug::log<NONE>("┣ --verbose               →  Print more logging");
+    Debug::log<NONE>("┣ --trace-file            →  Record a timeline to the given file (chrome://tracing, ui.perfetto.dev)");
+    Debug::log<NONE>("┣ --backend               →  Where colors are applied: auto (default), ctm, gamma or null (no compositor)");
+    Debug::log<NONE>("┣ --timezone              →  Follow the schedule in this zone (e.g. Europe/Berlin) instead of the system's");
+    Debug::log<NONE>("┣ --simulate              →  Run the schedule over FROM..TO (YYYY-MM-DD[THH:MM]) and print every wakeup, then exit");
+    Debug::log<NONE>("┣ --format                →  Output of --simulate: csv (default) or json");
+    Debug::log<NONE>("┣ --version           -v  →  Print the version");
+    Debug::log<NONE>("┣ --help              -h  →  Print this info");
+    Debug::log<NONE>("╹");
 }
 
 int main(int argc, char** argv, char** envp) {
-    std::string configPath;
+    std::string       configPath;
+    std::string       timezone;
+    std::string       simulateRange;
+    eSimulationFormat simulateFormat = SIMULATION_FORMAT_CSV;
 
     int         kelvin   = -1;
     float       gamma    = -1;
@@ -25,42 +58,42 @@ int main(int argc, char** argv, char** envp) {
     for (int i = 1; i < argc; ++i) {
         if (argv[i] == std::string{"-t"} || argv[i] == std::string{"--temperature"}) {
             if (i + 1 >= argc) {
-                Debug::log(NONE, "✖ No temperature provided for {}", argv[i]);
+                Debug::log<NONE>("✖ No temperature provided for {}", argv[i]);
                 return 1;
             }
 
             try {
                 kelvin = std::stoull(argv[i + 1]);
             } catch (std::exception& e) {
-                Debug::log(NONE, "✖ Temperature {} is not valid", argv[i + 1]);
+                Debug::log<NONE>("✖ Temperature {} is not valid", argv[i + 1]);
                 return 1;
             }
 
             ++i;
         } else if (argv[i] == std::string{"-g"} || argv[i] == std::string{"--gamma"}) {
             if (i + 1 >= argc) {
-                Debug::log(NONE, "✖ No gamma provided for {}", argv[i]);
+                Debug::log<NONE>("✖ No gamma provided for {}", argv[i]);
                 return 1;
             }
 
             try {
                 gamma = std::stof(argv[i + 1]) / 100;
             } catch (std::exception& e) {
-                Debug::log(NONE, "✖ Gamma {} is not valid", argv[i + 1]);
+                Debug::log<NONE>("✖ Gamma {} is not valid", argv[i + 1]);
                 return 1;
             }
 
             ++i;
         } else if (argv[i] == std::string{"--gamma_max"}) {
             if (i + 1 >= argc) {
-                Debug::log(NONE, "✖ No gamma provided for {}", argv[i]);
+                Debug::log<NONE>("✖ No gamma provided for {}", argv[i]);
                 return 1;
             }
 
             try {
                 maxGamma = std::stof(argv[i + 1]) / 100;
             } catch (std::exception& e) {
-                Debug::log(NONE, "✖ Maximum gamma {} is not valid", argv[i + 1]);
+                Debug::log<NONE>("✖ Maximum gamma {} is not valid", argv[i + 1]);
                 return 1;
             }
 
@@ -69,7 +102,7 @@ int main(int argc, char** argv, char** envp) {
             identity = true;
         } else if (argv[i] == std::string{"-c"} || argv[i] == std::string{"--config"}) {
             if (i + 1 >= argc) {
-                Debug::log(NONE, "✖ No config path provided for {}", argv[i]);
+                Debug::log<NONE>("✖ No config path provided for {}", argv[i]);
                 return 1;
             }
 
@@ -78,43 +111,147 @@ int main(int argc, char** argv, char** envp) {
             printHelp();
             return 0;
         } else if (argv[i] == std::string{"-v"} || argv[i] == std::string{"--version"}) {
-            Debug::log(NONE, "hyprsunset v{}", HYPRSUNSET_VERSION);
+            Debug::log<NONE>("hyprsunset v{}", HYPRSUNSET_VERSION);
             return 0;
         } else if (argv[i] == std::string{"--verbose"}) {
             Debug::trace = true;
+        } else if (argv[i] == std::string{"--trace-file"}) {
+            if (i + 1 >= argc) {
+                Debug::log<NONE>("✖ No trace file provided for {}", argv[i]);
+                return 1;
+            }
+
+            if (!Trace::open(argv[i + 1])) {
+                Debug::log<NONE>("✖ Couldn't open the trace file {}", argv[i + 1]);
+                return 1;
+            }
+
+            ++i;
+        } else if (argv[i] == std::string{"--backend"}) {
+            if (i + 1 >= argc) {
+                Debug::log<NONE>("✖ No backend provided for {}", argv[i]);
+                return 1;
+            }
+
+            const auto TYPE = Backend::typeFromName(argv[i + 1]);
+            if (!TYPE) {
+                Debug::log<NONE>("✖ Backend {} is not valid, expected auto, ctm, gamma or null", argv[i + 1]);
+                return 1;
+            }
+
+            g_pHyprsunset->BACKEND = *TYPE;
+
+            ++i;
+        } else if (argv[i] == std::string{"--timezone"}) {
+            if (i + 1 >= argc) {
+                Debug::log<NONE>("✖ No timezone provided for {}", argv[i]);
+                return 1;
+            }
+
+            timezone = argv[i + 1];
+
+            ++i;
+        } else if (argv[i] == std::string{"--simulate"}) {
+            if (i + 1 >= argc) {
+                Debug::log<NONE>("✖ No range provided for {}", argv[i]);
+                return 1;
+            }
+
+            simulateRange = argv[i + 1];
+
+            ++i;
+        } else if (argv[i] == std::string{"--format"}) {
+            if (i + 1 >= argc) {
+                Debug::log<NONE>("✖ No format provided for {}", argv[i]);
+                return 1;
+            }
+
+            if (argv[i + 1] == std::string{"csv"})
+                simulateFormat = SIMULATION_FORMAT_CSV;
+            else if (argv[i + 1] == std::string{"json"})
+                simulateFormat = SIMULATION_FORMAT_JSON;
+            else {
+                Debug::log<NONE>("✖ Format {} is not valid, expected csv or json", argv[i + 1]);
+                return 1;
+            }
+
+            ++i;
         } else {
-            Debug::log(NONE, "✖ Argument not recognized: {}", argv[i]);
+            Debug::log<NONE>("✖ Argument not recognized: {}", argv[i]);
             printHelp();
             return 1;
         }
     }
 
-    Debug::log(NONE, "┏ hyprsunset v{} ━━╸\n┃", HYPRSUNSET_VERSION);
+    // the timeline goes to stdout on its own
+    if (!simulateRange.empty())
+        Debug::outputFD = STDERR_FILENO;
+
+    if (!timezone.empty()) {
+        try {
+            g_pHyprsunset->TIMEZONE = std::chrono::locate_zone(timezone);
+        } catch (std::exception& e) {
+            Debug::log<NONE>("✖ Timezone {} is not valid", timezone);
+            return 1;
+        }
+    }
+
+    Debug::log<NONE>("┏ hyprsunset v{} ━━╸\n┃", HYPRSUNSET_VERSION);
 
     g_pConfigManager = makeUnique<CConfigManager>(configPath);
-    g_pConfigManager->init();
 
-    g_pHyprsunset->loadCurrentProfile();
+    // the snapshot is only good for the same config and the same arguments
+    const auto ARGS = std::format("{} {} {} {} {}", kelvin, gamma, maxGamma, identity, timezone);
+
+    // the last state goes back on screen first, the parse below corrects it if needed
+    if (simulateRange.empty() && !g_pHyprsunset->preinit(Hash::fnv1a(ARGS)))
+        return 1;
+
+    {
+        TRACE_SCOPE("config parse");
 
-    if (kelvin != -1) {
-        g_pHyprsunset->KELVIN    = kelvin;
-        g_pHyprsunset->kelvinSet = true;
-        g_pHyprsunset->identity  = false;
+        g_pConfigManager->init();
+
+        g_pHyprsunset->loadCurrentProfile();
     }
 
+    // kept around, a config reload puts them back on top
+    if (kelvin != -1)
+        g_pHyprsunset->cliOverrides.kelvin = kelvin;
+
     if (gamma != -1)
-        g_pHyprsunset->GAMMA = gamma;
+        g_pHyprsunset->cliOverrides.gamma = gamma;
 
     if (maxGamma != -1)
-        g_pHyprsunset->MAX_GAMMA = maxGamma;
+        g_pHyprsunset->cliOverrides.maxGamma = maxGamma;
 
-    if (identity)
-        g_pHyprsunset->identity = true;
+    g_pHyprsunset->cliOverrides.identity = identity;
+
+    g_pHyprsunset->applyCLIOverrides();
 
     if (!g_pHyprsunset->calculateMatrix())
         return 1;
-    if (!g_pHyprsunset->init())
-        return 1;
 
-    return 0;
+    if (!simulateRange.empty()) {
+        const auto ZONE      = g_pHyprsunset->TIMEZONE ? g_pHyprsunset->TIMEZONE : std::chrono::current_zone();
+        const auto SEPARATOR = simulateRange.find("..");
+        const auto FROM      = SEPARATOR == std::string::npos ? std::nullopt : parseLocalTime(simulateRange.substr(0, SEPARATOR), ZONE);
+        const auto TO        = SEPARATOR == std::string::npos ? std::nullopt : parseLocalTime(simulateRange.substr(SEPARATOR + 2), ZONE);
+
+        if (!FROM || !TO || *TO <= *FROM) {
+            Debug::log<NONE>("✖ Simulation range {} is not valid, expected FROM..TO like 2025-01-01..2026-01-01", simulateRange);
+            return 1;
+        }
+
+        const int RESULT = g_pHyprsunset->simulate(*FROM, *TO, simulateFormat);
+        Trace::close();
+        return RESULT ? 0 : 1;
+    }
+
+    const int RESULT = g_pHyprsunset->init();
+
+    // flush here, while this thread's trace buffer is still alive
+    Trace::close();
+
+    return RESULT ? 0 : 1;
 }
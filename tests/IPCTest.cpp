@@ -0,0 +1,92 @@
+#include "HyprsunsetProcess.hpp"
+#include "MockCompositor.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <poll.h>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Talks to a real hyprsunset the way its clients do, exits non-zero if a reply doesn't come.
+// Usage: hyprsunset-test-ipc [path to hyprsunset]
+
+// well below ipc:timeout, a reply that only comes when the daemon gives up on the client doesn't count
+constexpr int REPLY_TIMEOUT_MS = 2000;
+
+static CHyprsunsetProcess hyprsunset;
+
+// sends request as is and keeps the connection open, like hyprctl does. returns what came back before the timeout, at most length bytes
+static std::string roundTrip(std::string_view request, size_t length) {
+    const int FD = hyprsunset.connectIPC();
+    if (FD < 0)
+        return "";
+
+    std::string reply;
+
+    if (send(FD, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size()) {
+        pollfd pfd = {.fd = FD, .events = POLLIN};
+
+        while (reply.size() < length && poll(&pfd, 1, REPLY_TIMEOUT_MS) > 0) {
+            char       buffer[1024];
+            const auto LEN = read(FD, buffer, std::min(sizeof(buffer), length - reply.size()));
+            if (LEN <= 0)
+                break;
+
+            reply.append(buffer, LEN);
+        }
+    }
+
+    close(FD);
+
+    return reply;
+}
+
+static bool expectReply(std::string_view name, std::string_view request, std::string_view expected) {
+    const auto REPLY = roundTrip(request, expected.size());
+    const bool OK    = REPLY == expected;
+
+    std::cout << (OK ? "PASS " : "FAIL ") << name;
+    if (!OK)
+        std::cout << ": expected \"" << expected << "\", got \"" << REPLY << "\"";
+    std::cout << "\n";
+
+    return OK;
+}
+
+int main(int argc, char** argv) {
+    const std::string BINARY = argc > 1 ? argv[1] : HYPRSUNSET_BINARY;
+
+    if (!hyprsunset.prepare("ipc {\n    timeout = 10000\n}\n")) {
+        std::cerr << "Couldn't create a runtime dir: " << strerror(errno) << "\n";
+        return 1;
+    }
+
+    CMockCompositor compositor;
+    if (!compositor.start()) {
+        std::cerr << "Couldn't start the mock compositor\n";
+        return 1;
+    }
+
+    compositor.addOutput("TEST-1", "hyprsunset mock output 1");
+
+    if (!hyprsunset.launch(BINARY, compositor)) {
+        std::cerr << "hyprsunset (" << BINARY << ") didn't come up\n";
+        return 1;
+    }
+
+    bool ok = true;
+
+    // hyprctl hyprsunset neither terminates its request nor shuts down its end
+    ok &= expectReply("unterminated request", "temperature 4000", "ok");
+    ok &= expectReply("terminated request", "temperature 5000\n", "ok\n");
+    ok &= expectReply("pipelined requests", "temperature 4500\ngamma 90\n", "ok\nok\n");
+
+    hyprsunset.stop();
+    compositor.stop();
+
+    return ok ? 0 : 1;
+}